@@ -0,0 +1,86 @@
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <lwip/dns.h>
+#include <time.h>
+
+// Non-blocking SNTP client on top of a monotonic 64-bit microsecond clock.
+//
+// nowUs() is the CPU clock since boot and never jumps; measure intervals with
+// it. Wall time is a model of that clock (offset plus drift) disciplined by
+// NTP replies: frequency error is estimated between samples and small offsets
+// are slewed in, so the wall clock does not jump either unless it is off by
+// more than a second. Until the first reply arrives isValid() is false and
+// there is no wall time at all.
+class TimeService
+{
+public:
+    TimeService(const char *server, unsigned long pollIntervalMs = 60000);
+
+    void begin();
+    // Call from loop(); sends, receives and retries without ever waiting.
+    void update();
+
+    static inline uint64_t nowUs() { return micros64(); }
+
+    bool isValid() const { return _valid; }
+    // Wall time for a nowUs() reading, in microseconds/seconds since the Unix
+    // epoch. Only meaningful once isValid().
+    int64_t toEpochUs(uint64_t monoUs) const;
+    time_t toEpoch(uint64_t monoUs) const { return (time_t)(toEpochUs(monoUs) / 1000000); }
+    time_t epoch() const { return toEpoch(nowUs()); }
+
+    float driftPpm() const { return _driftPpm; }
+    uint64_t lastSyncUs() const { return _lastSyncUs; }
+
+    // Applies one measurement taken at nowUs() == now: the server read
+    // epochUs at our monoUs, over a round trip of delayUs. update() calls
+    // this for every reply.
+    void discipline(uint64_t now, uint64_t monoUs, int64_t epochUs, uint64_t delayUs);
+
+private:
+    enum State
+    {
+        STATE_IDLE,
+        STATE_RESOLVING,
+        STATE_WAITING,
+    };
+
+    static void onServerFound(const char *name, const ip_addr_t *ipaddr, void *arg);
+
+    void resolveServer();
+    void sendRequest();
+    bool receiveReply();
+    void scheduleRetry();
+
+    const char *_server;
+    unsigned long _pollIntervalMs;
+    WiFiUDP _udp;
+
+    State _state = STATE_IDLE;
+    volatile bool _resolved = false;
+    volatile bool _resolveFailed = false;
+    IPAddress _serverIP;
+    uint64_t _nextPollUs = 0;
+    uint64_t _sentUs = 0;
+    uint8_t _cookie[8];
+    unsigned long _retryMs = 0;
+    uint8_t _failures = 0;
+
+    bool _valid = false;
+    // Wall time is _anchorEpochUs at _anchorUs, advancing at (1 + drift)
+    // plus a bounded slew of _slewUs towards the last measured offset
+    uint64_t _anchorUs = 0;
+    int64_t _anchorEpochUs = 0;
+    float _driftPpm = 0.0;
+    int64_t _slewUs = 0;
+    uint64_t _sampleUs = 0;
+    int64_t _sampleEpochUs = 0;
+    uint64_t _sampleDelayUs = 0;
+    uint64_t _bestDelayUs = 0;
+    uint64_t _lastSyncUs = 0;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// Settings for the host emulation build (env:native). A config.h in
+// include/ takes precedence; this one only exists so a fresh checkout can
+// build and talk to a broker on the same machine.
+
+const char *ssid = "osmio-host";
+const char *password = "";
+const char *mqtt_server = "127.0.0.1";
+
+const char *baseTopic = "home/";
+const char *resetFilterTopic = "/resetFilter";
+
+#define CARBON_FILTER_LITRES 7500.0
+#define CARBON_FILTER_DAYS 180
+#define KDF_GAC_FILTER_LITRES 15000.0
+#define KDF_GAC_FILTER_DAYS 365
+#define CERAMIC_FILTER_LITRES 5000.0
+#define CERAMIC_FILTER_DAYS 180
+
+#endif
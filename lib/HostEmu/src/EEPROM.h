@@ -0,0 +1,54 @@
+#ifndef HOSTEMU_EEPROM_H
+#define HOSTEMU_EEPROM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+// RAM image of the emulated flash sector, written back on commit() like the
+// ESP8266 core. put() only marks the image dirty when bytes actually change.
+class EEPROMClass
+{
+public:
+    void begin(size_t size);
+    bool end();
+    bool commit();
+
+    uint8_t read(int address) const;
+    void write(int address, uint8_t value);
+    size_t length() const { return _data.size(); }
+    uint8_t *getDataPtr();
+    const uint8_t *getConstDataPtr() const { return _data.data(); }
+
+    template <typename T>
+    T &get(int address, T &value)
+    {
+        if (address >= 0 && address + sizeof(T) <= _data.size())
+        {
+            memcpy(&value, _data.data() + address, sizeof(T));
+        }
+        return value;
+    }
+
+    template <typename T>
+    const T &put(int address, const T &value)
+    {
+        if (address >= 0 && address + sizeof(T) <= _data.size() &&
+            memcmp(_data.data() + address, &value, sizeof(T)) != 0)
+        {
+            memcpy(_data.data() + address, &value, sizeof(T));
+            _dirty = true;
+        }
+        return value;
+    }
+
+private:
+    std::vector<uint8_t> _data;
+    bool _dirty = false;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
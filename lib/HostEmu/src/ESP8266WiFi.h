@@ -0,0 +1,42 @@
+#ifndef HOSTEMU_ESP8266WIFI_H
+#define HOSTEMU_ESP8266WIFI_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiClient.h"
+#include "WiFiUdp.h"
+
+typedef enum
+{
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_WRONG_PASSWORD = 6,
+    WL_DISCONNECTED = 7
+} wl_status_t;
+
+// The station is the host's loopback interface: it is always associated and
+// credentials are ignored.
+class ESP8266WiFiClass
+{
+public:
+    wl_status_t begin(const char *ssid, const char *passphrase = nullptr);
+    wl_status_t begin(const String &ssid, const String &passphrase = String()) { return begin(ssid.c_str(), passphrase.c_str()); }
+    bool disconnect(bool wifiOff = false);
+    wl_status_t status() { return _status; }
+    bool isConnected() { return _status == WL_CONNECTED; }
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    String macAddress();
+    int hostByName(const char *host, IPAddress &result);
+
+private:
+    wl_status_t _status = WL_IDLE_STATUS;
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef HOSTEMU_ESPASYNCTCP_H
+#define HOSTEMU_ESPASYNCTCP_H
+
+// The emulated AsyncWebServer owns its sockets directly (see
+// ESPAsyncWebServer.h); there is no separate async TCP layer on the host.
+
+#endif
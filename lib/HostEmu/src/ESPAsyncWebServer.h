@@ -0,0 +1,168 @@
+#ifndef HOSTEMU_ESPASYNCWEBSERVER_H
+#define HOSTEMU_ESPASYNCWEBSERVER_H
+
+// Subset of ESPAsyncWebServer served from real sockets. Requests are parsed
+// and dispatched from hostemu::serviceSystem(), i.e. between loop()
+// iterations and inside delay()/yield(), which is where the ESP8266 runs
+// AsyncTCP callbacks. A slow loop() therefore shows up as HTTP latency.
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Arduino.h"
+#include "FS.h"
+#include "HostEmu.h"
+
+typedef enum
+{
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServerRequest;
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+
+class AsyncWebParameter
+{
+public:
+    AsyncWebParameter(const String &name, const String &value, bool form = false, bool file = false)
+        : _name(name), _value(value), _isForm(form), _isFile(file) {}
+
+    const String &name() const { return _name; }
+    const String &value() const { return _value; }
+    bool isPost() const { return _isForm; }
+    bool isFile() const { return _isFile; }
+
+private:
+    String _name;
+    String _value;
+    bool _isForm;
+    bool _isFile;
+};
+
+class AsyncWebServerRequest
+{
+public:
+    AsyncWebServerRequest(WebRequestMethodComposite method, const String &url)
+        : _method(method), _url(url) {}
+
+    WebRequestMethodComposite method() const { return _method; }
+    const String &url() const { return _url; }
+
+    size_t params() const { return _params.size(); }
+    AsyncWebParameter *getParam(size_t index) const;
+    bool hasParam(const String &name, bool post = false, bool file = false) const;
+    AsyncWebParameter *getParam(const String &name, bool post = false, bool file = false) const;
+    void addParam(const AsyncWebParameter &param) { _params.push_back(param); }
+
+    void send(int code, const String &contentType = String(), const String &content = String());
+    void send(fs::FS &fs, const String &path, const String &contentType = String());
+
+    bool responded() const { return _code != 0; }
+    int responseCode() const { return _code; }
+    const std::string &responseHead() const { return _head; }
+    const std::string &responseBody() const { return _body; }
+
+private:
+    WebRequestMethodComposite _method;
+    String _url;
+    mutable std::vector<AsyncWebParameter> _params;
+
+    int _code = 0;
+    std::string _head;
+    std::string _body;
+};
+
+class AsyncWebHandler
+{
+public:
+    virtual ~AsyncWebHandler() {}
+    virtual bool canHandle(AsyncWebServerRequest *request) = 0;
+    virtual void handleRequest(AsyncWebServerRequest *request) = 0;
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler
+{
+public:
+    AsyncCallbackWebHandler(const String &uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest)
+        : _uri(uri), _method(method), _onRequest(std::move(onRequest)) {}
+
+    bool canHandle(AsyncWebServerRequest *request) override;
+    void handleRequest(AsyncWebServerRequest *request) override;
+
+private:
+    String _uri;
+    WebRequestMethodComposite _method;
+    ArRequestHandlerFunction _onRequest;
+};
+
+class AsyncStaticWebHandler : public AsyncWebHandler
+{
+public:
+    AsyncStaticWebHandler(const char *uri, fs::FS &fs, const char *path, const char *cacheControl);
+
+    AsyncStaticWebHandler &setDefaultFile(const char *filename);
+    AsyncStaticWebHandler &setCacheControl(const char *cacheControl);
+
+    bool canHandle(AsyncWebServerRequest *request) override;
+    void handleRequest(AsyncWebServerRequest *request) override;
+
+private:
+    String resolve(const String &url);
+
+    String _uri;
+    fs::FS &_fs;
+    String _path;
+    String _defaultFile = "index.htm";
+    String _cacheControl;
+};
+
+class AsyncWebServer : public hostemu::Service
+{
+public:
+    explicit AsyncWebServer(uint16_t port) : _port(port) {}
+    ~AsyncWebServer() override;
+
+    void begin();
+    void end();
+
+    AsyncCallbackWebHandler &on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+    AsyncCallbackWebHandler &on(const char *uri, ArRequestHandlerFunction onRequest) { return on(uri, HTTP_ANY, onRequest); }
+    AsyncStaticWebHandler &serveStatic(const char *uri, fs::FS &fs, const char *path, const char *cacheControl = nullptr);
+    void onNotFound(ArRequestHandlerFunction fn) { _notFound = std::move(fn); }
+
+    void preparePoll(std::vector<pollfd> &fds) override;
+    void handlePoll(const pollfd *fds, size_t count) override;
+
+private:
+    struct Connection
+    {
+        int fd;
+        std::string in;
+        std::string out;
+        size_t outPos = 0;
+        bool dispatched = false;
+    };
+
+    void accept();
+    bool receive(Connection &connection);
+    void dispatch(Connection &connection);
+    bool flush(Connection &connection);
+
+    uint16_t _port;
+    int _listenFd = -1;
+    std::vector<std::unique_ptr<AsyncWebHandler>> _handlers;
+    ArRequestHandlerFunction _notFound;
+    std::vector<Connection> _connections;
+};
+
+#endif
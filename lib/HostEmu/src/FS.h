@@ -0,0 +1,72 @@
+#ifndef HOSTEMU_FS_H
+#define HOSTEMU_FS_H
+
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+
+#include "Stream.h"
+
+namespace fs
+{
+class FileImpl;
+
+// File on the host filesystem, shared between copies like the core's File.
+class File : public Stream
+{
+public:
+    File() {}
+    explicit File(std::shared_ptr<FileImpl> impl) : _impl(std::move(impl)) {}
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    size_t read(uint8_t *buffer, size_t size);
+    int peek() override;
+    void flush() override;
+
+    bool seek(uint32_t position);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    const char *name() const;
+    bool isDirectory() const;
+    operator bool() const { return _impl != nullptr; }
+
+private:
+    std::shared_ptr<FileImpl> _impl;
+};
+
+// Filesystem rooted at a host directory; "/index.html" maps to
+// <root>/index.html.
+class FS
+{
+public:
+    explicit FS(std::string root) : _root(std::move(root)) {}
+
+    bool begin();
+    void end() { _mounted = false; }
+    File open(const char *path, const char *mode = "r");
+    File open(const String &path, const char *mode = "r") { return open(path.c_str(), mode); }
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char *path);
+    bool rename(const char *pathFrom, const char *pathTo);
+    bool mkdir(const char *path);
+
+    void setRoot(std::string root) { _root = std::move(root); }
+    std::string hostPath(const char *path) const;
+
+private:
+    std::string _root;
+    bool _mounted = false;
+};
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif
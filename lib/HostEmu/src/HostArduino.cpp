@@ -0,0 +1,242 @@
+#include "Arduino.h"
+#include "HostEmu.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace
+{
+const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+const std::thread::id firmwareThread = std::this_thread::get_id();
+
+struct InterruptSlot
+{
+    void (*handler)() = nullptr;
+};
+
+// Held while an emulated ISR runs and while the main thread masks
+// interrupts, so handlers never interleave with noInterrupts() sections.
+std::recursive_mutex interruptLock;
+InterruptSlot interruptSlots[17];
+bool interruptsMasked = false;
+
+std::vector<hostemu::Service *> services;
+bool inSystemContext = false;
+
+std::mt19937 rng;
+} // namespace
+
+HardwareSerial Serial;
+
+namespace hostemu
+{
+Options &options()
+{
+    static Options instance;
+    return instance;
+}
+
+Counters &counters()
+{
+    static Counters instance;
+    return instance;
+}
+
+void registerService(Service *service)
+{
+    services.push_back(service);
+}
+
+void unregisterService(Service *service)
+{
+    services.erase(std::remove(services.begin(), services.end(), service), services.end());
+}
+
+void serviceSystem(int timeoutMs)
+{
+    // Network callbacks never nest on the device; a handler that calls
+    // delay() just waits. Harness threads never run firmware callbacks.
+    if (inSystemContext || services.empty() || std::this_thread::get_id() != firmwareThread)
+    {
+        if (timeoutMs > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        }
+        return;
+    }
+
+    std::vector<pollfd> fds;
+    std::vector<size_t> starts;
+    for (Service *service : services)
+    {
+        starts.push_back(fds.size());
+        service->preparePoll(fds);
+    }
+    if (poll(fds.data(), fds.size(), timeoutMs) < 0)
+    {
+        return;
+    }
+
+    inSystemContext = true;
+    std::vector<Service *> snapshot = services;
+    for (size_t i = 0; i < snapshot.size(); i++)
+    {
+        size_t end = i + 1 < starts.size() ? starts[i + 1] : fds.size();
+        snapshot[i]->handlePoll(fds.data() + starts[i], end - starts[i]);
+    }
+    inSystemContext = false;
+}
+
+bool injectPulse(uint8_t pin)
+{
+    std::lock_guard<std::recursive_mutex> lock(interruptLock);
+    const InterruptSlot &slot = interruptSlots[pin < 17 ? pin : 0];
+    if (pin >= 17 || !slot.handler)
+    {
+        counters().pulsesLost++;
+        return false;
+    }
+    slot.handler();
+    counters().pulsesDelivered++;
+    return true;
+}
+} // namespace hostemu
+
+unsigned long millis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+unsigned long micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+uint64_t micros64()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void delay(unsigned long ms)
+{
+    unsigned long start = millis();
+    for (;;)
+    {
+        unsigned long elapsed = millis() - start;
+        if (elapsed >= ms)
+        {
+            break;
+        }
+        hostemu::serviceSystem((int)(ms - elapsed));
+    }
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield()
+{
+    hostemu::serviceSystem(0);
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+int digitalRead(uint8_t pin)
+{
+    (void)pin;
+    return HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    (void)pin;
+    (void)value;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode)
+{
+    if (pin >= 17)
+    {
+        return;
+    }
+    (void)mode;
+    std::lock_guard<std::recursive_mutex> lock(interruptLock);
+    interruptSlots[pin].handler = handler;
+}
+
+void detachInterrupt(uint8_t pin)
+{
+    if (pin >= 17)
+    {
+        return;
+    }
+    std::lock_guard<std::recursive_mutex> lock(interruptLock);
+    interruptSlots[pin].handler = nullptr;
+}
+
+void noInterrupts()
+{
+    if (!interruptsMasked)
+    {
+        interruptLock.lock();
+        interruptsMasked = true;
+    }
+}
+
+void interrupts()
+{
+    if (interruptsMasked)
+    {
+        interruptsMasked = false;
+        interruptLock.unlock();
+    }
+}
+
+void randomSeed(unsigned long seed)
+{
+    rng.seed(seed);
+}
+
+long random(long max)
+{
+    return max > 0 ? random(0, max) : 0;
+}
+
+long random(long min, long max)
+{
+    if (min >= max)
+    {
+        return min;
+    }
+    return std::uniform_int_distribution<long>(min, max - 1)(rng);
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    if (!hostemu::options().quiet)
+    {
+        fwrite(buffer, 1, size, stdout);
+    }
+    return size;
+}
+
+void HardwareSerial::flush()
+{
+    fflush(stdout);
+}
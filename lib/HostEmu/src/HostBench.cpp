@@ -0,0 +1,376 @@
+#include "Arduino.h"
+#include "HostEmu.h"
+#include "WiFiClient.h"
+
+#include <PubSubClient.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Load harness: a synthetic flow sensor on the interrupt pin, dashboard
+// pollers hitting /data over HTTP and an MQTT client that sends reset
+// commands and counts what the firmware publishes. Everything runs on a
+// fixed schedule so two runs of the same build are comparable.
+
+namespace
+{
+typedef std::chrono::steady_clock Clock;
+
+// Log-linear histogram of microsecond samples, ~3% resolution
+class LatencyHistogram
+{
+public:
+    LatencyHistogram() : _buckets(BUCKETS, 0) {}
+
+    void record(uint64_t us)
+    {
+        _buckets[bucketOf(us)]++;
+        _count++;
+        _sum += us;
+        if (us > _max)
+        {
+            _max = us;
+        }
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (size_t i = 0; i < BUCKETS; i++)
+        {
+            _buckets[i] += other._buckets[i];
+        }
+        _count += other._count;
+        _sum += other._sum;
+        if (other._max > _max)
+        {
+            _max = other._max;
+        }
+    }
+
+    uint64_t count() const { return _count; }
+    uint64_t max() const { return _max; }
+    double mean() const { return _count ? (double)_sum / _count : 0.0; }
+
+    uint64_t percentile(double p) const
+    {
+        if (!_count)
+        {
+            return 0;
+        }
+        uint64_t rank = (uint64_t)(p / 100.0 * (_count - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; i++)
+        {
+            seen += _buckets[i];
+            if (seen >= rank)
+            {
+                return std::min(upperBound(i), _max);
+            }
+        }
+        return _max;
+    }
+
+private:
+    static const size_t BUCKETS = 64 + 58 * 32;
+
+    static size_t bucketOf(uint64_t v)
+    {
+        if (v < 64)
+        {
+            return v;
+        }
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - 5;
+        return 64 + (msb - 6) * 32 + ((v >> shift) - 32);
+    }
+
+    static uint64_t upperBound(size_t bucket)
+    {
+        if (bucket < 64)
+        {
+            return bucket;
+        }
+        size_t shift = (bucket - 64) / 32 + 1;
+        uint64_t mantissa = (bucket - 64) % 32 + 32;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> _buckets;
+    uint64_t _count = 0;
+    uint64_t _sum = 0;
+    uint64_t _max = 0;
+};
+
+struct PollerResult
+{
+    LatencyHistogram latency;
+    uint64_t ok = 0;
+    uint64_t errors = 0;
+};
+
+std::atomic<bool> harnessStop{false};
+std::atomic<unsigned> harnessThreads{0};
+std::atomic<uint64_t> pulsesGenerated{0};
+
+std::string resetTopic;
+std::atomic<uint64_t> mqttMessages{0};
+std::atomic<uint64_t> mqttBytes{0};
+std::atomic<uint64_t> resetsSent{0};
+std::atomic<bool> mqttConnected{false};
+
+void pulseGenerator()
+{
+    const hostemu::Options &options = hostemu::options();
+    if (options.pulseHz > 0)
+    {
+        Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.pulseHz));
+        Clock::time_point next = Clock::now();
+        while (!harnessStop)
+        {
+            next += period;
+            std::this_thread::sleep_until(next);
+            hostemu::injectPulse(options.pulsePin);
+            pulsesGenerated++;
+        }
+    }
+    harnessThreads--;
+}
+
+// Plain blocking HTTP/1.1 GET; true on a complete 200 response
+bool httpGet(uint16_t port, const char *path)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    timeval timeout = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: osmio\r\nConnection: close\r\n\r\n";
+    std::string response;
+    bool ok = connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0 &&
+              send(fd, request.data(), request.size(), MSG_NOSIGNAL) == (ssize_t)request.size();
+    while (ok)
+    {
+        char buffer[2048];
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n == 0)
+        {
+            break;
+        }
+        if (n < 0)
+        {
+            ok = false;
+            break;
+        }
+        response.append(buffer, n);
+    }
+    close(fd);
+    return ok && response.compare(0, 12, "HTTP/1.1 200") == 0;
+}
+
+void poller(PollerResult &result, unsigned index)
+{
+    const hostemu::Options &options = hostemu::options();
+    Clock::duration interval = std::chrono::milliseconds(options.pollIntervalMs);
+
+    // Stagger the pollers evenly across one interval
+    Clock::time_point next = Clock::now() + interval * index / std::max(options.pollers, 1u);
+    while (!harnessStop)
+    {
+        std::this_thread::sleep_until(next);
+        if (harnessStop)
+        {
+            break;
+        }
+        Clock::time_point start = Clock::now();
+        bool ok = httpGet(options.httpPort, "/data");
+        uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+        if (ok)
+        {
+            result.ok++;
+            result.latency.record(us);
+        }
+        else
+        {
+            result.errors++;
+        }
+        next = std::max(next + interval, Clock::now());
+    }
+    harnessThreads--;
+}
+
+void onMqttMessage(char *topic, uint8_t *payload, unsigned int length)
+{
+    (void)payload;
+    if (resetTopic != topic)
+    {
+        mqttMessages++;
+        mqttBytes += length;
+    }
+}
+
+void mqttDriver()
+{
+    static const char *const commands[] = {
+        "{\"filter\":\"carbon\"}",
+        "{\"filter\":\"kdfgac\"}",
+        "{\"filter\":\"ceramic\"}",
+        "{\"command\":\"full_reset\"}",
+    };
+
+    const hostemu::Options &options = hostemu::options();
+    String macAddr = options.macAddress.c_str();
+    macAddr.replace(":", "");
+
+    WiFiClient net;
+    PubSubClient mqtt(net);
+    mqtt.setServer(options.mqttHost.c_str(), options.mqttPort);
+    mqtt.setCallback(onMqttMessage);
+    if (mqtt.connect(("osmio-bench-" + macAddr).c_str()))
+    {
+        mqttConnected = true;
+        mqtt.subscribe(("home/" + macAddr + "/#").c_str());
+    }
+
+    Clock::duration interval = std::chrono::milliseconds(options.resetIntervalMs);
+    Clock::time_point nextReset = Clock::now() + interval;
+    size_t command = 0;
+    while (!harnessStop && mqttConnected)
+    {
+        mqtt.loop();
+        if (options.resetIntervalMs && Clock::now() >= nextReset)
+        {
+            if (mqtt.publish(resetTopic.c_str(), commands[command]))
+            {
+                resetsSent++;
+            }
+            command = (command + 1) % (sizeof(commands) / sizeof(commands[0]));
+            nextReset += interval;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    mqtt.disconnect();
+    harnessThreads--;
+}
+
+void printLatency(const char *label, const LatencyHistogram &histogram)
+{
+    printf("%-12s samples=%llu mean=%.0fus p50=%lluus p90=%lluus p99=%lluus p99.9=%lluus max=%lluus\n",
+           label,
+           (unsigned long long)histogram.count(),
+           histogram.mean(),
+           (unsigned long long)histogram.percentile(50),
+           (unsigned long long)histogram.percentile(90),
+           (unsigned long long)histogram.percentile(99),
+           (unsigned long long)histogram.percentile(99.9),
+           (unsigned long long)histogram.max());
+}
+} // namespace
+
+namespace hostemu
+{
+int runBenchmark(void (*loopOnce)())
+{
+    const Options &opts = options();
+    resetTopic = opts.resetTopic;
+    if (resetTopic.empty())
+    {
+        String macAddr = opts.macAddress.c_str();
+        macAddr.replace(":", "");
+        resetTopic = std::string("home/") + macAddr.c_str() + "/resetFilter";
+    }
+
+    std::vector<PollerResult> pollerResults(opts.pollers);
+    std::vector<std::thread> threads;
+    harnessThreads = 2 + opts.pollers;
+    threads.emplace_back(pulseGenerator);
+    threads.emplace_back(mqttDriver);
+    for (unsigned i = 0; i < opts.pollers; i++)
+    {
+        threads.emplace_back(poller, std::ref(pollerResults[i]), i);
+    }
+
+    uint64_t commitsBefore = counters().eepromCommits;
+    uint64_t flashWritesBefore = counters().eepromFlashWrites;
+    LatencyHistogram loopLatency;
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::seconds(opts.benchSeconds);
+    Clock::time_point now = start;
+    while (now < deadline && !stopRequested())
+    {
+        loopOnce();
+        Clock::time_point after = Clock::now();
+        loopLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(after - now).count());
+        now = after;
+    }
+    double elapsed = std::chrono::duration<double>(now - start).count();
+
+    harnessStop = true;
+    uint64_t messages = mqttMessages;
+    uint64_t bytes = mqttBytes;
+    threads[0].join();
+    uint64_t generated = pulsesGenerated;
+    uint64_t delivered = counters().pulsesDelivered;
+    uint64_t lost = counters().pulsesLost;
+
+    // Keep the firmware running until in-flight requests have been answered
+    while (harnessThreads)
+    {
+        loopOnce();
+    }
+    for (size_t i = 1; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+
+    PollerResult http;
+    for (const PollerResult &result : pollerResults)
+    {
+        http.latency.merge(result.latency);
+        http.ok += result.ok;
+        http.errors += result.errors;
+    }
+
+    printf("\nosmio host benchmark: %.1fs, pulses %.1f Hz, %u pollers every %u ms, reset every %u ms\n",
+           elapsed, opts.pulseHz, opts.pollers, opts.pollIntervalMs, opts.resetIntervalMs);
+    printLatency("loop", loopLatency);
+    printf("%-12s %.0f iterations/s\n", "", loopLatency.count() / elapsed);
+    printLatency("http /data", http.latency);
+    printf("%-12s ok=%llu errors=%llu\n", "", (unsigned long long)http.ok, (unsigned long long)http.errors);
+    if (mqttConnected)
+    {
+        printf("%-12s received=%llu (%.1f msg/s, %.0f B/s) resets_sent=%llu\n", "mqtt",
+               (unsigned long long)messages, messages / elapsed, bytes / elapsed,
+               (unsigned long long)resetsSent.load());
+    }
+    else
+    {
+        printf("%-12s broker %s:%u unreachable, publish throughput not measured\n", "mqtt",
+               opts.mqttHost.c_str(), opts.mqttPort);
+    }
+    printf("%-12s generated=%llu delivered=%llu lost=%llu (%.2f%%)\n", "pulses",
+           (unsigned long long)generated, (unsigned long long)delivered, (unsigned long long)lost,
+           generated ? 100.0 * lost / generated : 0.0);
+    printf("%-12s commits=%llu flash_writes=%llu\n", "eeprom",
+           (unsigned long long)(counters().eepromCommits - commitsBefore),
+           (unsigned long long)(counters().eepromFlashWrites - flashWritesBefore));
+    return 0;
+}
+} // namespace hostemu
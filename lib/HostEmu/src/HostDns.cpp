@@ -0,0 +1,119 @@
+#include "HostEmu.h"
+#include "lwip/dns.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct Lookup
+{
+    std::string name;
+    bool found;
+    ip_addr_t address;
+    dns_found_callback callback;
+    void *callbackArg;
+};
+
+// Wakes serviceSystem() through a pipe when a helper thread finishes
+class DnsService : public hostemu::Service
+{
+public:
+    DnsService()
+    {
+        if (pipe(_pipe) == 0)
+        {
+            fcntl(_pipe[0], F_SETFL, fcntl(_pipe[0], F_GETFL, 0) | O_NONBLOCK);
+            hostemu::registerService(this);
+        }
+    }
+
+    void complete(const Lookup &lookup)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _done.push_back(lookup);
+        }
+        char wake = 1;
+        ssize_t n = write(_pipe[1], &wake, 1);
+        (void)n;
+    }
+
+    void preparePoll(std::vector<pollfd> &fds) override
+    {
+        fds.push_back({_pipe[0], POLLIN, 0});
+    }
+
+    void handlePoll(const pollfd *fds, size_t count) override
+    {
+        if (!count || !(fds[0].revents & POLLIN))
+        {
+            return;
+        }
+        char buffer[64];
+        while (read(_pipe[0], buffer, sizeof(buffer)) > 0)
+        {
+        }
+
+        std::vector<Lookup> done;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            done.swap(_done);
+        }
+        for (const Lookup &lookup : done)
+        {
+            lookup.callback(lookup.name.c_str(), lookup.found ? &lookup.address : nullptr, lookup.callbackArg);
+        }
+    }
+
+private:
+    int _pipe[2] = {-1, -1};
+    std::mutex _mutex;
+    std::vector<Lookup> _done;
+};
+
+DnsService &dnsService()
+{
+    static DnsService instance;
+    return instance;
+}
+} // namespace
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg)
+{
+    if (!hostname || !addr || !found)
+    {
+        return ERR_ARG;
+    }
+
+    in_addr numeric;
+    if (inet_pton(AF_INET, hostname, &numeric) == 1)
+    {
+        addr->addr = numeric.s_addr;
+        return ERR_OK;
+    }
+
+    DnsService &service = dnsService();
+    Lookup lookup = {hostname, false, {0}, found, callback_arg};
+    std::thread([lookup, &service]() mutable
+                {
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        addrinfo *info = nullptr;
+        if (getaddrinfo(lookup.name.c_str(), nullptr, &hints, &info) == 0 && info)
+        {
+            lookup.address.addr = reinterpret_cast<const sockaddr_in *>(info->ai_addr)->sin_addr.s_addr;
+            lookup.found = true;
+            freeaddrinfo(info);
+        }
+        service.complete(lookup); })
+        .detach();
+    return ERR_INPROGRESS;
+}
@@ -0,0 +1,89 @@
+#include "EEPROM.h"
+#include "HostEmu.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <thread>
+
+EEPROMClass EEPROM;
+
+// A missing image starts zeroed rather than 0xFF so that initializeEEPROM()
+// sees an uninitialised flag and formats it, as on a device whose sector
+// was cleared by an earlier firmware.
+void EEPROMClass::begin(size_t size)
+{
+    _data.assign(size, 0);
+    _dirty = false;
+
+    const std::string &image = hostemu::options().eepromImage;
+    if (image.empty())
+    {
+        return;
+    }
+    FILE *file = fopen(image.c_str(), "rb");
+    if (file)
+    {
+        size_t n = fread(_data.data(), 1, _data.size(), file);
+        (void)n;
+        fclose(file);
+    }
+}
+
+bool EEPROMClass::end()
+{
+    bool result = commit();
+    _data.clear();
+    return result;
+}
+
+bool EEPROMClass::commit()
+{
+    hostemu::counters().eepromCommits++;
+    if (!_dirty || _data.empty())
+    {
+        return true;
+    }
+
+    hostemu::counters().eepromFlashWrites++;
+    unsigned long cost = hostemu::options().flashCommitUs;
+    if (cost)
+    {
+        // The device erases and rewrites the whole sector with the CPU stalled
+        std::this_thread::sleep_for(std::chrono::microseconds(cost));
+    }
+
+    const std::string &image = hostemu::options().eepromImage;
+    if (!image.empty())
+    {
+        FILE *file = fopen(image.c_str(), "wb");
+        if (!file)
+        {
+            return false;
+        }
+        fwrite(_data.data(), 1, _data.size(), file);
+        fclose(file);
+    }
+    _dirty = false;
+    return true;
+}
+
+uint8_t EEPROMClass::read(int address) const
+{
+    return address >= 0 && (size_t)address < _data.size() ? _data[address] : 0;
+}
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+    if (address >= 0 && (size_t)address < _data.size() && _data[address] != value)
+    {
+        _data[address] = value;
+        _dirty = true;
+    }
+}
+
+uint8_t *EEPROMClass::getDataPtr()
+{
+    _dirty = true;
+    return _data.data();
+}
@@ -0,0 +1,82 @@
+#ifndef HOSTEMU_HOSTEMU_H
+#define HOSTEMU_HOSTEMU_H
+
+// Controls of the host emulator itself. Nothing in here exists on the
+// device; the firmware never includes this header.
+
+#include <poll.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace hostemu
+{
+struct Options
+{
+    std::string fsRoot = "data";       // directory backing LittleFS
+    std::string eepromImage;           // EEPROM backing file, empty keeps it in memory
+    std::string macAddress = "5C:CF:7F:00:00:01";
+    uint16_t httpPort = 8080;          // replaces the port passed to AsyncWebServer
+    std::string httpBind = "127.0.0.1"; // address the web server listens on
+    unsigned long flashCommitUs = 0;   // modelled cost of one EEPROM.commit() that writes flash
+    bool quiet = false;                // discard Serial output
+
+    // Benchmark mode, enabled when benchSeconds > 0
+    unsigned benchSeconds = 0;
+    uint8_t pulsePin = 4;              // GPIO the synthetic flow sensor is wired to (D2)
+    double pulseHz = 100.0;
+    unsigned pollers = 4;
+    unsigned pollIntervalMs = 250;
+    unsigned resetIntervalMs = 2000;
+    std::string mqttHost = "127.0.0.1";
+    uint16_t mqttPort = 1883;
+    std::string resetTopic;            // defaults to home/<mac>/resetFilter
+};
+
+Options &options();
+
+// Anything owning sockets that must be serviced from the "system context",
+// i.e. between loop() iterations and inside delay()/yield(), the same points
+// at which the ESP8266 SDK runs its network callbacks.
+class Service
+{
+public:
+    virtual ~Service() {}
+    virtual void preparePoll(std::vector<pollfd> &fds) = 0;
+    virtual void handlePoll(const pollfd *fds, size_t count) = 0;
+};
+
+void registerService(Service *service);
+void unregisterService(Service *service);
+
+// Runs pending system work, waiting up to timeoutMs for socket activity.
+void serviceSystem(int timeoutMs);
+
+// Delivers one pulse on pin to its interrupt handler from the calling thread.
+// A pulse has both edges, so the handler runs once whatever mode it was
+// attached with. Returns false when no handler was attached, i.e. the pulse
+// is lost.
+bool injectPulse(uint8_t pin);
+
+struct Counters
+{
+    std::atomic<uint64_t> pulsesDelivered{0};
+    std::atomic<uint64_t> pulsesLost{0};
+    std::atomic<uint64_t> eepromCommits{0};
+    std::atomic<uint64_t> eepromFlashWrites{0};
+    std::atomic<uint64_t> httpRequests{0};
+};
+
+Counters &counters();
+
+// True once SIGINT/SIGTERM asked the emulator to wind down
+bool stopRequested();
+
+// Runs the load harness against the already set-up firmware and prints the
+// report; loopOnce drives one loop() iteration plus system servicing.
+int runBenchmark(void (*loopOnce)());
+} // namespace hostemu
+
+#endif
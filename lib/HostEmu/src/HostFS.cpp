@@ -0,0 +1,242 @@
+#include "HostEmu.h"
+#include "LittleFS.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+fs::FS LittleFS("");
+
+namespace fs
+{
+class FileImpl
+{
+public:
+    FileImpl(FILE *file, std::string name, bool directory)
+        : file(file), name(std::move(name)), directory(directory) {}
+    ~FileImpl()
+    {
+        if (file)
+        {
+            fclose(file);
+        }
+    }
+
+    FILE *file;
+    std::string name;
+    bool directory;
+};
+
+size_t File::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buffer, size_t size)
+{
+    if (!_impl || !_impl->file)
+    {
+        return 0;
+    }
+    return fwrite(buffer, 1, size, _impl->file);
+}
+
+int File::available()
+{
+    if (!_impl || !_impl->file)
+    {
+        return 0;
+    }
+    return (int)(size() - position());
+}
+
+int File::read()
+{
+    if (!_impl || !_impl->file)
+    {
+        return -1;
+    }
+    int c = fgetc(_impl->file);
+    return c == EOF ? -1 : c;
+}
+
+size_t File::read(uint8_t *buffer, size_t size)
+{
+    if (!_impl || !_impl->file)
+    {
+        return 0;
+    }
+    return fread(buffer, 1, size, _impl->file);
+}
+
+int File::peek()
+{
+    if (!_impl || !_impl->file)
+    {
+        return -1;
+    }
+    int c = fgetc(_impl->file);
+    if (c == EOF)
+    {
+        return -1;
+    }
+    ungetc(c, _impl->file);
+    return c;
+}
+
+void File::flush()
+{
+    if (_impl && _impl->file)
+    {
+        fflush(_impl->file);
+    }
+}
+
+bool File::seek(uint32_t position)
+{
+    return _impl && _impl->file && fseek(_impl->file, position, SEEK_SET) == 0;
+}
+
+size_t File::position() const
+{
+    if (!_impl || !_impl->file)
+    {
+        return 0;
+    }
+    long position = ftell(_impl->file);
+    return position < 0 ? 0 : (size_t)position;
+}
+
+size_t File::size() const
+{
+    if (!_impl || !_impl->file)
+    {
+        return 0;
+    }
+    struct stat info;
+    if (fstat(fileno(_impl->file), &info) != 0)
+    {
+        return 0;
+    }
+    return (size_t)info.st_size;
+}
+
+void File::close()
+{
+    _impl.reset();
+}
+
+const char *File::name() const
+{
+    return _impl ? _impl->name.c_str() : "";
+}
+
+bool File::isDirectory() const
+{
+    return _impl && _impl->directory;
+}
+
+bool FS::begin()
+{
+    if (_root.empty())
+    {
+        _root = hostemu::options().fsRoot;
+    }
+    struct stat info;
+    _mounted = stat(_root.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+    return _mounted;
+}
+
+// A ".." segment would leave the root directory, which the device's flash
+// filesystem cannot express
+static bool escapesRoot(const char *path)
+{
+    const char *segment = path;
+    while (true)
+    {
+        const char *end = strchr(segment, '/');
+        size_t length = end ? (size_t)(end - segment) : strlen(segment);
+        if (length == 2 && segment[0] == '.' && segment[1] == '.')
+        {
+            return true;
+        }
+        if (!end)
+        {
+            return false;
+        }
+        segment = end + 1;
+    }
+}
+
+// Empty for paths outside the root, so every host call on them fails
+std::string FS::hostPath(const char *path) const
+{
+    if (path && escapesRoot(path))
+    {
+        return std::string();
+    }
+    std::string result = _root;
+    if (path && *path != '/')
+    {
+        result += '/';
+    }
+    if (path)
+    {
+        result += path;
+    }
+    return result;
+}
+
+File FS::open(const char *path, const char *mode)
+{
+    if (!_mounted || !path)
+    {
+        return File();
+    }
+
+    std::string fullPath = hostPath(path);
+    if (fullPath.empty())
+    {
+        return File();
+    }
+    struct stat info;
+    if (stat(fullPath.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+    {
+        return File(std::make_shared<FileImpl>(nullptr, path, true));
+    }
+
+    // Text and binary modes are the same on the device, so always binary
+    std::string hostMode = mode ? mode : "r";
+    if (hostMode.find('b') == std::string::npos)
+    {
+        hostMode += 'b';
+    }
+    FILE *file = fopen(fullPath.c_str(), hostMode.c_str());
+    if (!file)
+    {
+        return File();
+    }
+    return File(std::make_shared<FileImpl>(file, path, false));
+}
+
+bool FS::exists(const char *path)
+{
+    struct stat info;
+    return _mounted && path && stat(hostPath(path).c_str(), &info) == 0;
+}
+
+bool FS::remove(const char *path)
+{
+    return _mounted && path && unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *pathFrom, const char *pathTo)
+{
+    return _mounted && pathFrom && pathTo &&
+           ::rename(hostPath(pathFrom).c_str(), hostPath(pathTo).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path)
+{
+    return _mounted && path && ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+} // namespace fs
@@ -0,0 +1,143 @@
+#include "Arduino.h"
+#include "HostEmu.h"
+
+#include <signal.h>
+
+#include <atomic>
+#include <string>
+
+// The firmware's entry points, defined in src/
+void setup();
+void loop();
+
+namespace
+{
+std::atomic<bool> stopFlag{false};
+
+// Unit tests under test/ link the same objects and bring their own main()
+#ifndef PIO_UNIT_TESTING
+void onSignal(int)
+{
+    stopFlag = true;
+}
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --fs DIR               directory served as LittleFS (default: data)\n"
+            "  --eeprom FILE          persist the EEPROM image in FILE (default: RAM only)\n"
+            "  --mac AA:BB:CC:DD:EE:FF  station MAC address\n"
+            "  --http-port N          port the web server listens on (default: 8080)\n"
+            "  --http-bind ADDR       address the web server listens on; 0.0.0.0 exposes\n"
+            "                         it and the LittleFS directory to the network\n"
+            "                         (default: 127.0.0.1)\n"
+            "  --flash-commit-us N    modelled cost of an EEPROM commit that writes flash\n"
+            "  --quiet                discard Serial output\n"
+            "benchmark:\n"
+            "  --bench SECONDS        run the load harness for SECONDS and print a report\n"
+            "  --pulse-hz F           synthetic flow sensor pulse rate (default: 100)\n"
+            "  --pollers N            concurrent /data pollers (default: 4)\n"
+            "  --poll-interval-ms N   delay between polls per poller (default: 250)\n"
+            "  --reset-interval-ms N  MQTT reset command period, 0 disables (default: 2000)\n"
+            "  --mqtt-host HOST       broker used by the harness (default: 127.0.0.1)\n"
+            "  --mqtt-port N          (default: 1883)\n"
+            "  --reset-topic TOPIC    (default: home/<mac>/resetFilter)\n",
+            program);
+}
+
+bool parseOptions(int argc, char **argv)
+{
+    hostemu::Options &options = hostemu::options();
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--quiet")
+        {
+            options.quiet = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        const char *value = argv[++i];
+        if (arg == "--fs")
+            options.fsRoot = value;
+        else if (arg == "--eeprom")
+            options.eepromImage = value;
+        else if (arg == "--mac")
+            options.macAddress = value;
+        else if (arg == "--http-port")
+            options.httpPort = (uint16_t)atoi(value);
+        else if (arg == "--http-bind")
+            options.httpBind = value;
+        else if (arg == "--flash-commit-us")
+            options.flashCommitUs = strtoul(value, nullptr, 10);
+        else if (arg == "--bench")
+            options.benchSeconds = (unsigned)atoi(value);
+        else if (arg == "--pulse-hz")
+            options.pulseHz = atof(value);
+        else if (arg == "--pollers")
+            options.pollers = (unsigned)atoi(value);
+        else if (arg == "--poll-interval-ms")
+            options.pollIntervalMs = (unsigned)atoi(value);
+        else if (arg == "--reset-interval-ms")
+            options.resetIntervalMs = (unsigned)atoi(value);
+        else if (arg == "--mqtt-host")
+            options.mqttHost = value;
+        else if (arg == "--mqtt-port")
+            options.mqttPort = (uint16_t)atoi(value);
+        else if (arg == "--reset-topic")
+            options.resetTopic = value;
+        else
+            return false;
+    }
+    return true;
+}
+
+// One pass of the core's main loop: the sketch, then system tasks
+void loopOnce()
+{
+    loop();
+    hostemu::serviceSystem(0);
+}
+#endif
+} // namespace
+
+namespace hostemu
+{
+bool stopRequested()
+{
+    return stopFlag;
+}
+} // namespace hostemu
+
+#ifndef PIO_UNIT_TESTING
+int main(int argc, char **argv)
+{
+    if (!parseOptions(argc, argv))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    setup();
+
+    if (hostemu::options().benchSeconds)
+    {
+        return hostemu::runBenchmark(loopOnce);
+    }
+
+    while (!stopFlag)
+    {
+        loopOnce();
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,541 @@
+#include "ESPAsyncWebServer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+const size_t MAX_REQUEST_SIZE = 16 * 1024;
+
+const char *reasonPhrase(int code)
+{
+    switch (code)
+    {
+    case 200:
+        return "OK";
+    case 302:
+        return "Found";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 500:
+        return "Internal Server Error";
+    default:
+        return "";
+    }
+}
+
+WebRequestMethodComposite parseMethod(const std::string &method)
+{
+    if (method == "GET")
+        return HTTP_GET;
+    if (method == "POST")
+        return HTTP_POST;
+    if (method == "DELETE")
+        return HTTP_DELETE;
+    if (method == "PUT")
+        return HTTP_PUT;
+    if (method == "PATCH")
+        return HTTP_PATCH;
+    if (method == "HEAD")
+        return HTTP_HEAD;
+    if (method == "OPTIONS")
+        return HTTP_OPTIONS;
+    return 0;
+}
+
+String urlDecode(const std::string &text)
+{
+    std::string decoded;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (text[i] == '+')
+        {
+            decoded.push_back(' ');
+        }
+        else if (text[i] == '%' && i + 2 < text.size() && isxdigit((unsigned char)text[i + 1]) &&
+                 isxdigit((unsigned char)text[i + 2]))
+        {
+            decoded.push_back((char)strtol(text.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        }
+        else
+        {
+            decoded.push_back(text[i]);
+        }
+    }
+    return String(decoded);
+}
+
+void parseParams(AsyncWebServerRequest &request, const std::string &encoded, bool form)
+{
+    size_t start = 0;
+    while (start < encoded.size())
+    {
+        size_t end = encoded.find('&', start);
+        if (end == std::string::npos)
+        {
+            end = encoded.size();
+        }
+        std::string pair = encoded.substr(start, end - start);
+        if (!pair.empty())
+        {
+            size_t equals = pair.find('=');
+            std::string name = pair.substr(0, equals);
+            std::string value = equals == std::string::npos ? "" : pair.substr(equals + 1);
+            request.addParam(AsyncWebParameter(urlDecode(name), urlDecode(value), form));
+        }
+        start = end + 1;
+    }
+}
+
+std::string headerValue(const std::string &head, const char *name)
+{
+    size_t nameLength = strlen(name);
+    size_t pos = head.find("\r\n");
+    while (pos != std::string::npos && pos + 2 < head.size())
+    {
+        size_t lineStart = pos + 2;
+        size_t lineEnd = head.find("\r\n", lineStart);
+        if (lineEnd == std::string::npos)
+        {
+            lineEnd = head.size();
+        }
+        if (lineEnd - lineStart > nameLength && head[lineStart + nameLength] == ':' &&
+            strncasecmp(head.c_str() + lineStart, name, nameLength) == 0)
+        {
+            size_t valueStart = head.find_first_not_of(' ', lineStart + nameLength + 1);
+            return valueStart < lineEnd ? head.substr(valueStart, lineEnd - valueStart) : "";
+        }
+        pos = lineEnd;
+    }
+    return "";
+}
+
+String contentTypeFor(const String &path)
+{
+    if (path.endsWith(".html") || path.endsWith(".htm"))
+        return "text/html";
+    if (path.endsWith(".css"))
+        return "text/css";
+    if (path.endsWith(".js"))
+        return "application/javascript";
+    if (path.endsWith(".json"))
+        return "application/json";
+    if (path.endsWith(".png"))
+        return "image/png";
+    if (path.endsWith(".ico"))
+        return "image/x-icon";
+    if (path.endsWith(".svg"))
+        return "image/svg+xml";
+    return "text/plain";
+}
+} // namespace
+
+AsyncWebParameter *AsyncWebServerRequest::getParam(size_t index) const
+{
+    return index < _params.size() ? &_params[index] : nullptr;
+}
+
+bool AsyncWebServerRequest::hasParam(const String &name, bool post, bool file) const
+{
+    return getParam(name, post, file) != nullptr;
+}
+
+AsyncWebParameter *AsyncWebServerRequest::getParam(const String &name, bool post, bool file) const
+{
+    for (AsyncWebParameter &param : _params)
+    {
+        if (param.name() == name && param.isPost() == post && param.isFile() == file)
+        {
+            return &param;
+        }
+    }
+    return nullptr;
+}
+
+void AsyncWebServerRequest::send(int code, const String &contentType, const String &content)
+{
+    if (responded())
+    {
+        return;
+    }
+    _code = code;
+    _body = content.str();
+
+    _head = "HTTP/1.1 " + std::to_string(code) + " " + reasonPhrase(code) + "\r\n";
+    if (contentType.length())
+    {
+        _head += "Content-Type: " + contentType.str() + "\r\n";
+    }
+    _head += "Content-Length: " + std::to_string(_body.size()) + "\r\n";
+    _head += "Connection: close\r\n\r\n";
+}
+
+void AsyncWebServerRequest::send(fs::FS &fs, const String &path, const String &contentType)
+{
+    File file = fs.open(path, "r");
+    if (!file || file.isDirectory())
+    {
+        send(404);
+        return;
+    }
+    std::string content(file.size(), '\0');
+    content.resize(file.read((uint8_t *)&content[0], content.size()));
+    send(200, contentType.length() ? contentType : contentTypeFor(path), String(content));
+}
+
+bool AsyncCallbackWebHandler::canHandle(AsyncWebServerRequest *request)
+{
+    if (!(_method & request->method()))
+    {
+        return false;
+    }
+    return !_uri.length() || _uri == request->url() || request->url().startsWith(_uri + "/");
+}
+
+void AsyncCallbackWebHandler::handleRequest(AsyncWebServerRequest *request)
+{
+    if (_onRequest)
+    {
+        _onRequest(request);
+    }
+    else
+    {
+        request->send(500);
+    }
+}
+
+AsyncStaticWebHandler::AsyncStaticWebHandler(const char *uri, fs::FS &fs, const char *path, const char *cacheControl)
+    : _uri(uri), _fs(fs), _path(path), _cacheControl(cacheControl)
+{
+    if (_uri.endsWith("/"))
+    {
+        _uri.remove(_uri.length() - 1);
+    }
+    if (_path.endsWith("/"))
+    {
+        _path.remove(_path.length() - 1);
+    }
+}
+
+AsyncStaticWebHandler &AsyncStaticWebHandler::setDefaultFile(const char *filename)
+{
+    _defaultFile = filename;
+    return *this;
+}
+
+AsyncStaticWebHandler &AsyncStaticWebHandler::setCacheControl(const char *cacheControl)
+{
+    _cacheControl = cacheControl;
+    return *this;
+}
+
+String AsyncStaticWebHandler::resolve(const String &url)
+{
+    String path = _path + url.substring(_uri.length());
+    if (!path.length())
+    {
+        path = "/";
+    }
+    if (path.endsWith("/"))
+    {
+        path += _defaultFile;
+    }
+    else
+    {
+        File file = _fs.open(path, "r");
+        if (file && file.isDirectory())
+        {
+            path += "/" + _defaultFile;
+        }
+    }
+    return path;
+}
+
+bool AsyncStaticWebHandler::canHandle(AsyncWebServerRequest *request)
+{
+    if (!(request->method() & (HTTP_GET | HTTP_HEAD)) || !request->url().startsWith(_uri))
+    {
+        return false;
+    }
+    File file = _fs.open(resolve(request->url()), "r");
+    return file && !file.isDirectory();
+}
+
+void AsyncStaticWebHandler::handleRequest(AsyncWebServerRequest *request)
+{
+    request->send(_fs, resolve(request->url()));
+}
+
+AsyncWebServer::~AsyncWebServer()
+{
+    end();
+}
+
+void AsyncWebServer::begin()
+{
+    if (_listenFd >= 0)
+    {
+        return;
+    }
+
+    uint16_t port = hostemu::options().httpPort ? hostemu::options().httpPort : _port;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return;
+    }
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, hostemu::options().httpBind.c_str(), &address.sin_addr) != 1)
+    {
+        fprintf(stderr, "hostemu: invalid --http-bind address %s\n", hostemu::options().httpBind.c_str());
+        close(fd);
+        return;
+    }
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(fd, 16) < 0)
+    {
+        fprintf(stderr, "hostemu: cannot listen on port %u: %s\n", port, strerror(errno));
+        close(fd);
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    _listenFd = fd;
+    hostemu::registerService(this);
+}
+
+void AsyncWebServer::end()
+{
+    if (_listenFd < 0)
+    {
+        return;
+    }
+    hostemu::unregisterService(this);
+    for (Connection &connection : _connections)
+    {
+        close(connection.fd);
+    }
+    _connections.clear();
+    close(_listenFd);
+    _listenFd = -1;
+}
+
+AsyncCallbackWebHandler &AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest)
+{
+    AsyncCallbackWebHandler *handler = new AsyncCallbackWebHandler(uri, method, std::move(onRequest));
+    _handlers.emplace_back(handler);
+    return *handler;
+}
+
+AsyncStaticWebHandler &AsyncWebServer::serveStatic(const char *uri, fs::FS &fs, const char *path, const char *cacheControl)
+{
+    AsyncStaticWebHandler *handler = new AsyncStaticWebHandler(uri, fs, path, cacheControl ? cacheControl : "");
+    _handlers.emplace_back(handler);
+    return *handler;
+}
+
+void AsyncWebServer::preparePoll(std::vector<pollfd> &fds)
+{
+    fds.push_back({_listenFd, POLLIN, 0});
+    for (const Connection &connection : _connections)
+    {
+        fds.push_back({connection.fd, (short)(connection.dispatched ? POLLOUT : POLLIN), 0});
+    }
+}
+
+void AsyncWebServer::handlePoll(const pollfd *fds, size_t count)
+{
+    // Connections accepted during this pass have no pollfd yet
+    size_t polled = count ? count - 1 : 0;
+    std::vector<Connection> kept;
+    for (size_t i = 0; i < _connections.size(); i++)
+    {
+        Connection &connection = _connections[i];
+        bool ready = i >= polled || (fds[i + 1].revents != 0);
+        bool open = true;
+        if (ready && !connection.dispatched)
+        {
+            open = receive(connection);
+            if (open && connection.dispatched)
+            {
+                open = flush(connection);
+            }
+        }
+        else if (ready)
+        {
+            open = flush(connection);
+        }
+
+        if (open)
+        {
+            kept.push_back(std::move(connection));
+        }
+        else
+        {
+            close(connection.fd);
+        }
+    }
+    _connections.swap(kept);
+
+    if (count && (fds[0].revents & POLLIN))
+    {
+        accept();
+    }
+}
+
+void AsyncWebServer::accept()
+{
+    for (;;)
+    {
+        int fd = ::accept(_listenFd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            return;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        int flag = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+        Connection connection;
+        connection.fd = fd;
+        _connections.push_back(std::move(connection));
+    }
+}
+
+// Returns false once the connection should be closed
+bool AsyncWebServer::receive(Connection &connection)
+{
+    char buffer[2048];
+    bool peerClosed = false;
+    for (;;)
+    {
+        ssize_t n = recv(connection.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (n > 0)
+        {
+            connection.in.append(buffer, n);
+            if (connection.in.size() > MAX_REQUEST_SIZE)
+            {
+                return false;
+            }
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+            peerClosed = true;
+        }
+        break;
+    }
+
+    size_t headEnd = connection.in.find("\r\n\r\n");
+    if (headEnd == std::string::npos)
+    {
+        return !peerClosed;
+    }
+    size_t bodyLength = strtoul(headerValue(connection.in.substr(0, headEnd), "Content-Length").c_str(), nullptr, 10);
+    if (connection.in.size() < headEnd + 4 + bodyLength)
+    {
+        return !peerClosed;
+    }
+
+    dispatch(connection);
+    return true;
+}
+
+void AsyncWebServer::dispatch(Connection &connection)
+{
+    size_t headEnd = connection.in.find("\r\n\r\n");
+    std::string head = connection.in.substr(0, headEnd);
+    std::string body = connection.in.substr(headEnd + 4);
+
+    std::string requestLine = head.substr(0, head.find("\r\n"));
+    size_t methodEnd = requestLine.find(' ');
+    size_t targetEnd = requestLine.find(' ', methodEnd + 1);
+    WebRequestMethodComposite method = 0;
+    std::string target;
+    if (methodEnd != std::string::npos && targetEnd != std::string::npos)
+    {
+        method = parseMethod(requestLine.substr(0, methodEnd));
+        target = requestLine.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    }
+
+    size_t queryStart = target.find('?');
+    AsyncWebServerRequest request(method, urlDecode(target.substr(0, queryStart)));
+    if (queryStart != std::string::npos)
+    {
+        parseParams(request, target.substr(queryStart + 1), false);
+    }
+    if (headerValue(head, "Content-Type").find("application/x-www-form-urlencoded") == 0)
+    {
+        parseParams(request, body, true);
+    }
+
+    hostemu::counters().httpRequests++;
+    if (!method || target.empty())
+    {
+        request.send(400);
+    }
+    else
+    {
+        AsyncWebHandler *handler = nullptr;
+        for (const std::unique_ptr<AsyncWebHandler> &candidate : _handlers)
+        {
+            if (candidate->canHandle(&request))
+            {
+                handler = candidate.get();
+                break;
+            }
+        }
+        if (handler)
+        {
+            handler->handleRequest(&request);
+        }
+        else if (_notFound)
+        {
+            _notFound(&request);
+        }
+        else
+        {
+            request.send(404);
+        }
+        if (!request.responded())
+        {
+            request.send(500);
+        }
+    }
+
+    connection.out = request.responseHead();
+    if (method != HTTP_HEAD)
+    {
+        connection.out += request.responseBody();
+    }
+    connection.in.clear();
+    connection.dispatched = true;
+}
+
+// Returns false once the response is fully written or the peer went away
+bool AsyncWebServer::flush(Connection &connection)
+{
+    while (connection.outPos < connection.out.size())
+    {
+        ssize_t n = send(connection.fd, connection.out.data() + connection.outPos,
+                         connection.out.size() - connection.outPos, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0)
+        {
+            connection.outPos += n;
+            continue;
+        }
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    return false;
+}
@@ -0,0 +1,431 @@
+#include "ESP8266WiFi.h"
+#include "HostEmu.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+ESP8266WiFiClass WiFi;
+
+namespace
+{
+const int CONNECT_TIMEOUT_MS = 5000;
+
+bool resolve(const char *host, IPAddress &result)
+{
+    if (result.fromString(host))
+    {
+        return true;
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    addrinfo *info = nullptr;
+    if (getaddrinfo(host, nullptr, &hints, &info) != 0 || !info)
+    {
+        return false;
+    }
+    const sockaddr_in *address = reinterpret_cast<const sockaddr_in *>(info->ai_addr);
+    result = IPAddress((uint32_t)address->sin_addr.s_addr);
+    freeaddrinfo(info);
+    return true;
+}
+
+sockaddr_in toSockaddr(IPAddress ip, uint16_t port)
+{
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = (uint32_t)ip;
+    return address;
+}
+
+void setNonBlocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+} // namespace
+
+IPAddress::IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth)
+{
+    _bytes[0] = first;
+    _bytes[1] = second;
+    _bytes[2] = third;
+    _bytes[3] = fourth;
+}
+
+IPAddress::IPAddress(uint32_t address)
+{
+    memcpy(_bytes, &address, sizeof(_bytes));
+}
+
+IPAddress::IPAddress(const uint8_t *address)
+{
+    memcpy(_bytes, address, sizeof(_bytes));
+}
+
+bool IPAddress::fromString(const char *address)
+{
+    in_addr parsed;
+    if (!address || inet_pton(AF_INET, address, &parsed) != 1)
+    {
+        return false;
+    }
+    memcpy(_bytes, &parsed.s_addr, sizeof(_bytes));
+    return true;
+}
+
+String IPAddress::toString() const
+{
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+    return String(buffer);
+}
+
+IPAddress::operator uint32_t() const
+{
+    uint32_t address;
+    memcpy(&address, _bytes, sizeof(address));
+    return address;
+}
+
+bool IPAddress::operator==(const IPAddress &other) const
+{
+    return memcmp(_bytes, other._bytes, sizeof(_bytes)) == 0;
+}
+
+size_t IPAddress::printTo(Print &p) const
+{
+    return p.print(toString());
+}
+
+wl_status_t ESP8266WiFiClass::begin(const char *ssid, const char *passphrase)
+{
+    (void)ssid;
+    (void)passphrase;
+    _status = WL_CONNECTED;
+    return _status;
+}
+
+bool ESP8266WiFiClass::disconnect(bool wifiOff)
+{
+    (void)wifiOff;
+    _status = WL_DISCONNECTED;
+    return true;
+}
+
+String ESP8266WiFiClass::macAddress()
+{
+    return String(hostemu::options().macAddress.c_str());
+}
+
+int ESP8266WiFiClass::hostByName(const char *host, IPAddress &result)
+{
+    return resolve(host, result) ? 1 : 0;
+}
+
+WiFiClient::~WiFiClient()
+{
+    stop();
+}
+
+int WiFiClient::connect(const char *host, uint16_t port)
+{
+    IPAddress ip;
+    if (!resolve(host, ip))
+    {
+        return 0;
+    }
+    return connect(ip, port);
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port)
+{
+    stop();
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return 0;
+    }
+    setNonBlocking(fd);
+
+    sockaddr_in address = toSockaddr(ip, port);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        if (errno != EINPROGRESS)
+        {
+            close(fd);
+            return 0;
+        }
+        pollfd pfd = {fd, POLLOUT, 0};
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (poll(&pfd, 1, CONNECT_TIMEOUT_MS) != 1 ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0)
+        {
+            close(fd);
+            return 0;
+        }
+    }
+
+    _fd = fd;
+    _peerClosed = false;
+    setNoDelay(true);
+    return 1;
+}
+
+void WiFiClient::setNoDelay(bool noDelay)
+{
+    if (_fd >= 0)
+    {
+        int flag = noDelay ? 1 : 0;
+        setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    }
+}
+
+size_t WiFiClient::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t WiFiClient::write(const uint8_t *buffer, size_t size)
+{
+    size_t sent = 0;
+    unsigned long start = millis();
+    while (_fd >= 0 && sent < size)
+    {
+        ssize_t n = send(_fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            sent += n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && millis() - start < _timeout)
+        {
+            pollfd pfd = {_fd, POLLOUT, 0};
+            poll(&pfd, 1, 10);
+            continue;
+        }
+        _peerClosed = true;
+        break;
+    }
+    return sent;
+}
+
+bool WiFiClient::fill()
+{
+    if (_fd < 0 || _peerClosed)
+    {
+        return false;
+    }
+    if (_rxPos == _rx.size())
+    {
+        _rx.clear();
+        _rxPos = 0;
+    }
+
+    char buffer[1460];
+    ssize_t n = recv(_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (n > 0)
+    {
+        _rx.append(buffer, n);
+        return true;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+    {
+        _peerClosed = true;
+    }
+    return false;
+}
+
+int WiFiClient::available()
+{
+    if (_rxPos == _rx.size())
+    {
+        fill();
+    }
+    return (int)(_rx.size() - _rxPos);
+}
+
+int WiFiClient::read()
+{
+    if (!available())
+    {
+        return -1;
+    }
+    return (uint8_t)_rx[_rxPos++];
+}
+
+int WiFiClient::read(uint8_t *buffer, size_t size)
+{
+    size_t count = std::min(size, (size_t)available());
+    memcpy(buffer, _rx.data() + _rxPos, count);
+    _rxPos += count;
+    return (int)count;
+}
+
+int WiFiClient::peek()
+{
+    if (!available())
+    {
+        return -1;
+    }
+    return (uint8_t)_rx[_rxPos];
+}
+
+void WiFiClient::stop()
+{
+    if (_fd >= 0)
+    {
+        close(_fd);
+        _fd = -1;
+    }
+    _peerClosed = false;
+    _rx.clear();
+    _rxPos = 0;
+}
+
+uint8_t WiFiClient::connected()
+{
+    if (_fd < 0)
+    {
+        return 0;
+    }
+    available();
+    return (!_peerClosed || _rxPos < _rx.size()) ? 1 : 0;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port)
+{
+    stop();
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+    {
+        return 0;
+    }
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address = toSockaddr(IPAddress(0, 0, 0, 0), port);
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        close(fd);
+        return 0;
+    }
+    setNonBlocking(fd);
+    _fd = fd;
+    return 1;
+}
+
+void WiFiUDP::stop()
+{
+    if (_fd >= 0)
+    {
+        close(_fd);
+        _fd = -1;
+    }
+    _tx.clear();
+    _rx.clear();
+    _rxPos = 0;
+}
+
+int WiFiUDP::beginPacket(const char *host, uint16_t port)
+{
+    IPAddress ip;
+    if (!resolve(host, ip))
+    {
+        return 0;
+    }
+    return beginPacket(ip, port);
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port)
+{
+    _txIP = ip;
+    _txPort = port;
+    _tx.clear();
+    return 1;
+}
+
+int WiFiUDP::endPacket()
+{
+    if (_fd < 0)
+    {
+        return 0;
+    }
+    sockaddr_in address = toSockaddr(_txIP, _txPort);
+    ssize_t n = sendto(_fd, _tx.data(), _tx.size(), 0, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+    _tx.clear();
+    return n >= 0 ? 1 : 0;
+}
+
+size_t WiFiUDP::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t WiFiUDP::write(const uint8_t *buffer, size_t size)
+{
+    _tx.append(reinterpret_cast<const char *>(buffer), size);
+    return size;
+}
+
+int WiFiUDP::parsePacket()
+{
+    _rx.clear();
+    _rxPos = 0;
+    if (_fd < 0)
+    {
+        return 0;
+    }
+
+    char buffer[1472];
+    sockaddr_in address = {};
+    socklen_t length = sizeof(address);
+    ssize_t n = recvfrom(_fd, buffer, sizeof(buffer), MSG_DONTWAIT, reinterpret_cast<sockaddr *>(&address), &length);
+    if (n <= 0)
+    {
+        return 0;
+    }
+    _rx.assign(buffer, n);
+    _remoteIP = IPAddress((uint32_t)address.sin_addr.s_addr);
+    _remotePort = ntohs(address.sin_port);
+    return (int)n;
+}
+
+int WiFiUDP::available()
+{
+    return (int)(_rx.size() - _rxPos);
+}
+
+int WiFiUDP::read()
+{
+    return _rxPos < _rx.size() ? (uint8_t)_rx[_rxPos++] : -1;
+}
+
+int WiFiUDP::read(unsigned char *buffer, size_t length)
+{
+    size_t count = std::min(length, _rx.size() - _rxPos);
+    memcpy(buffer, _rx.data() + _rxPos, count);
+    _rxPos += count;
+    return (int)count;
+}
+
+int WiFiUDP::peek()
+{
+    return _rxPos < _rx.size() ? (uint8_t)_rx[_rxPos] : -1;
+}
+
+void WiFiUDP::flush()
+{
+    _rx.clear();
+    _rxPos = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef HOSTEMU_IPADDRESS_H
+#define HOSTEMU_IPADDRESS_H
+
+#include <stdint.h>
+
+#include "Printable.h"
+#include "WString.h"
+
+class IPAddress : public Printable
+{
+public:
+    IPAddress() : IPAddress(0, 0, 0, 0) {}
+    IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth);
+    IPAddress(uint32_t address);
+    IPAddress(const uint8_t *address);
+
+    bool fromString(const char *address);
+    bool fromString(const String &address) { return fromString(address.c_str()); }
+    String toString() const;
+
+    // Network byte order, as stored in sockaddr_in
+    operator uint32_t() const;
+    bool operator==(const IPAddress &other) const;
+    bool operator!=(const IPAddress &other) const { return !(*this == other); }
+    uint8_t operator[](int index) const { return _bytes[index]; }
+    uint8_t &operator[](int index) { return _bytes[index]; }
+
+    size_t printTo(Print &p) const override;
+
+    uint8_t *raw_address() { return _bytes; }
+
+private:
+    uint8_t _bytes[4];
+};
+
+#endif
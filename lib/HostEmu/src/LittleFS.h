@@ -0,0 +1,10 @@
+#ifndef HOSTEMU_LITTLEFS_H
+#define HOSTEMU_LITTLEFS_H
+
+#include "FS.h"
+
+// Backed by hostemu::options().fsRoot, the project's data/ directory by
+// default, i.e. the same tree `pio run --target uploadfs` flashes.
+extern fs::FS LittleFS;
+
+#endif
@@ -0,0 +1,55 @@
+#include "Print.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <vector>
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--)
+    {
+        if (!write(*buffer++))
+        {
+            break;
+        }
+        n++;
+    }
+    return n;
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(nullptr, 0, format, copy);
+    va_end(copy);
+    if (length < 0)
+    {
+        va_end(args);
+        return 0;
+    }
+    std::vector<char> buffer(length + 1);
+    vsnprintf(buffer.data(), buffer.size(), format, args);
+    va_end(args);
+    return write((const uint8_t *)buffer.data(), length);
+}
+
+size_t Print::print(const __FlashStringHelper *str) { return write(reinterpret_cast<const char *>(str)); }
+size_t Print::print(const String &str) { return write(str.c_str(), str.length()); }
+size_t Print::print(const char str[]) { return write(str); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(unsigned char value, int base) { return print(String(value, base)); }
+size_t Print::print(int value, int base) { return print(String(value, base)); }
+size_t Print::print(unsigned int value, int base) { return print(String(value, base)); }
+size_t Print::print(long value, int base) { return print(String(value, base)); }
+size_t Print::print(unsigned long value, int base) { return print(String(value, base)); }
+size_t Print::print(long long value, int base) { return print(String(value, base)); }
+size_t Print::print(unsigned long long value, int base) { return print(String(value, base)); }
+size_t Print::print(double value, int digits) { return print(String(value, (unsigned char)digits)); }
+size_t Print::print(const Printable &printable) { return printable.printTo(*this); }
+
+size_t Print::println() { return write("\r\n"); }
@@ -0,0 +1,15 @@
+#ifndef HOSTEMU_PRINTABLE_H
+#define HOSTEMU_PRINTABLE_H
+
+#include <stddef.h>
+
+class Print;
+
+class Printable
+{
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print &p) const = 0;
+};
+
+#endif
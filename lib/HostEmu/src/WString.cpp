@@ -0,0 +1,267 @@
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace
+{
+template <typename T>
+std::string formatInteger(T value, unsigned char base)
+{
+    if (base < 2 || base > 36)
+    {
+        base = 10;
+    }
+
+    bool negative = value < 0;
+    unsigned long long magnitude = negative ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+
+    std::string digits;
+    do
+    {
+        unsigned digit = magnitude % base;
+        digits.push_back(digit < 10 ? '0' + digit : 'A' + digit - 10);
+        magnitude /= base;
+    } while (magnitude);
+
+    if (negative)
+    {
+        digits.push_back('-');
+    }
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+std::string formatFloat(double value, unsigned char decimalPlaces)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimalPlaces, value);
+    return buffer;
+}
+} // namespace
+
+String::String(const char *cstr) : _buffer(cstr ? cstr : "") {}
+String::String(const char *cstr, size_t length) : _buffer(cstr ? std::string(cstr, length) : std::string()) {}
+String::String(const __FlashStringHelper *str) : String(reinterpret_cast<const char *>(str)) {}
+String::String(char c) : _buffer(1, c) {}
+String::String(unsigned char value, unsigned char base) : _buffer(formatInteger(value, base)) {}
+String::String(int value, unsigned char base) : _buffer(formatInteger(value, base)) {}
+String::String(unsigned int value, unsigned char base) : _buffer(formatInteger(value, base)) {}
+String::String(long value, unsigned char base) : _buffer(formatInteger(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _buffer(formatInteger(value, base)) {}
+String::String(long long value, unsigned char base) : _buffer(formatInteger(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : _buffer(formatInteger(value, base)) {}
+String::String(float value, unsigned char decimalPlaces) : _buffer(formatFloat(value, decimalPlaces)) {}
+String::String(double value, unsigned char decimalPlaces) : _buffer(formatFloat(value, decimalPlaces)) {}
+
+String &String::operator=(const char *cstr)
+{
+    _buffer.assign(cstr ? cstr : "");
+    return *this;
+}
+
+bool String::reserve(unsigned int size)
+{
+    _buffer.reserve(size);
+    return true;
+}
+
+bool String::concat(const String &str)
+{
+    _buffer.append(str._buffer);
+    return true;
+}
+
+bool String::concat(const char *cstr)
+{
+    if (!cstr)
+    {
+        return false;
+    }
+    _buffer.append(cstr);
+    return true;
+}
+
+bool String::concat(const char *cstr, unsigned int length)
+{
+    if (!cstr)
+    {
+        return false;
+    }
+    _buffer.append(cstr, length);
+    return true;
+}
+
+bool String::concat(char c)
+{
+    _buffer.push_back(c);
+    return true;
+}
+
+bool String::concat(unsigned char value) { return concat(String(value)); }
+bool String::concat(int value) { return concat(String(value)); }
+bool String::concat(unsigned int value) { return concat(String(value)); }
+bool String::concat(long value) { return concat(String(value)); }
+bool String::concat(unsigned long value) { return concat(String(value)); }
+bool String::concat(float value) { return concat(String(value)); }
+bool String::concat(double value) { return concat(String(value)); }
+
+bool String::equalsIgnoreCase(const String &str) const
+{
+    return _buffer.size() == str._buffer.size() &&
+           strncasecmp(_buffer.c_str(), str._buffer.c_str(), _buffer.size()) == 0;
+}
+
+bool String::startsWith(const String &prefix) const
+{
+    return _buffer.compare(0, prefix._buffer.size(), prefix._buffer) == 0;
+}
+
+bool String::endsWith(const String &suffix) const
+{
+    return _buffer.size() >= suffix._buffer.size() &&
+           _buffer.compare(_buffer.size() - suffix._buffer.size(), suffix._buffer.size(), suffix._buffer) == 0;
+}
+
+char String::charAt(unsigned int index) const
+{
+    return index < _buffer.size() ? _buffer[index] : 0;
+}
+
+char &String::operator[](unsigned int index)
+{
+    static char dummy;
+    if (index >= _buffer.size())
+    {
+        dummy = 0;
+        return dummy;
+    }
+    return _buffer[index];
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const
+{
+    size_t pos = _buffer.find(c, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const
+{
+    size_t pos = _buffer.find(str._buffer, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c) const
+{
+    size_t pos = _buffer.rfind(c);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex) const
+{
+    return substring(beginIndex, _buffer.size());
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+    if (beginIndex > endIndex)
+    {
+        std::swap(beginIndex, endIndex);
+    }
+    if (beginIndex >= _buffer.size())
+    {
+        return String();
+    }
+    return String(_buffer.substr(beginIndex, endIndex - beginIndex));
+}
+
+void String::replace(char find, char replace)
+{
+    std::replace(_buffer.begin(), _buffer.end(), find, replace);
+}
+
+void String::replace(const String &find, const String &replace)
+{
+    if (find._buffer.empty())
+    {
+        return;
+    }
+    size_t pos = 0;
+    while ((pos = _buffer.find(find._buffer, pos)) != std::string::npos)
+    {
+        _buffer.replace(pos, find._buffer.size(), replace._buffer);
+        pos += replace._buffer.size();
+    }
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+    if (index < _buffer.size())
+    {
+        _buffer.erase(index, count);
+    }
+}
+
+void String::toLowerCase()
+{
+    for (char &c : _buffer)
+    {
+        c = tolower((unsigned char)c);
+    }
+}
+
+void String::toUpperCase()
+{
+    for (char &c : _buffer)
+    {
+        c = toupper((unsigned char)c);
+    }
+}
+
+void String::trim()
+{
+    size_t begin = _buffer.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+    {
+        _buffer.clear();
+        return;
+    }
+    size_t end = _buffer.find_last_not_of(" \t\r\n");
+    _buffer = _buffer.substr(begin, end - begin + 1);
+}
+
+long String::toInt() const { return atol(_buffer.c_str()); }
+float String::toFloat() const { return (float)atof(_buffer.c_str()); }
+double String::toDouble() const { return atof(_buffer.c_str()); }
+
+StringSumHelper operator+(const String &lhs, const String &rhs)
+{
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+StringSumHelper operator+(const String &lhs, const char *rhs)
+{
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+StringSumHelper operator+(const char *lhs, const String &rhs)
+{
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+StringSumHelper operator+(const String &lhs, char rhs)
+{
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}
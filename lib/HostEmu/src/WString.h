@@ -0,0 +1,112 @@
+#ifndef HOSTEMU_WSTRING_H
+#define HOSTEMU_WSTRING_H
+
+#include <stddef.h>
+#include <string>
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+// Arduino String backed by std::string. Assigning a null pointer yields an
+// empty string, which is what ArduinoJson relies on when it serializes into one.
+class String
+{
+public:
+    String(const char *cstr = "");
+    String(const char *cstr, size_t length);
+    String(const __FlashStringHelper *str);
+    String(const std::string &str) : _buffer(str) {}
+    String(const String &) = default;
+    String(String &&) = default;
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimalPlaces = 2);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+
+    String &operator=(const String &) = default;
+    String &operator=(String &&) = default;
+    String &operator=(const char *cstr);
+
+    const char *c_str() const { return _buffer.c_str(); }
+    unsigned int length() const { return _buffer.length(); }
+    bool isEmpty() const { return _buffer.empty(); }
+    bool reserve(unsigned int size);
+
+    bool concat(const String &str);
+    bool concat(const char *cstr);
+    bool concat(const char *cstr, unsigned int length);
+    bool concat(char c);
+    bool concat(unsigned char value);
+    bool concat(int value);
+    bool concat(unsigned int value);
+    bool concat(long value);
+    bool concat(unsigned long value);
+    bool concat(float value);
+    bool concat(double value);
+
+    template <typename T>
+    String &operator+=(const T &value)
+    {
+        concat(value);
+        return *this;
+    }
+
+    bool equals(const String &str) const { return _buffer == str._buffer; }
+    bool equals(const char *cstr) const { return _buffer == (cstr ? cstr : ""); }
+    bool equalsIgnoreCase(const String &str) const;
+    bool operator==(const String &str) const { return equals(str); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &str) const { return !equals(str); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+    bool operator<(const String &str) const { return _buffer < str._buffer; }
+    bool startsWith(const String &prefix) const;
+    bool endsWith(const String &suffix) const;
+
+    char charAt(unsigned int index) const;
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index);
+
+    int indexOf(char c, unsigned int fromIndex = 0) const;
+    int indexOf(const String &str, unsigned int fromIndex = 0) const;
+    int lastIndexOf(char c) const;
+    String substring(unsigned int beginIndex) const;
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(char find, char replace);
+    void replace(const String &find, const String &replace);
+    void remove(unsigned int index, unsigned int count = (unsigned int)-1);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+    const std::string &str() const { return _buffer; }
+
+private:
+    std::string _buffer;
+};
+
+// Result type of String concatenation, kept as a distinct type because
+// ArduinoJson's string adapters name it explicitly.
+class StringSumHelper : public String
+{
+public:
+    using String::String;
+    StringSumHelper(const String &str) : String(str) {}
+};
+
+StringSumHelper operator+(const String &lhs, const String &rhs);
+StringSumHelper operator+(const String &lhs, const char *rhs);
+StringSumHelper operator+(const char *lhs, const String &rhs);
+StringSumHelper operator+(const String &lhs, char rhs);
+
+#endif
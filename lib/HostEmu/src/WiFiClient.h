@@ -0,0 +1,43 @@
+#ifndef HOSTEMU_WIFICLIENT_H
+#define HOSTEMU_WIFICLIENT_H
+
+#include <string>
+
+#include "Client.h"
+
+// TCP client on a real POSIX socket. Connecting blocks like the lwIP client
+// does; reads never block.
+class WiFiClient : public Client
+{
+public:
+    WiFiClient() {}
+    ~WiFiClient() override;
+    WiFiClient(const WiFiClient &) = delete;
+    WiFiClient &operator=(const WiFiClient &) = delete;
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char *host, uint16_t port) override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int read(uint8_t *buffer, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return _fd >= 0; }
+
+    void setNoDelay(bool noDelay);
+
+private:
+    bool fill();
+
+    int _fd = -1;
+    bool _peerClosed = false;
+    std::string _rx;
+    size_t _rxPos = 0;
+};
+
+#endif
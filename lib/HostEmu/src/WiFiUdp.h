@@ -0,0 +1,48 @@
+#ifndef HOSTEMU_WIFIUDP_H
+#define HOSTEMU_WIFIUDP_H
+
+#include <string>
+
+#include "Udp.h"
+
+class WiFiUDP : public UDP
+{
+public:
+    WiFiUDP() {}
+    ~WiFiUDP() override { stop(); }
+    WiFiUDP(const WiFiUDP &) = delete;
+    WiFiUDP &operator=(const WiFiUDP &) = delete;
+
+    uint8_t begin(uint16_t port) override;
+    void stop() override;
+
+    int beginPacket(IPAddress ip, uint16_t port) override;
+    int beginPacket(const char *host, uint16_t port) override;
+    int endPacket() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+
+    int parsePacket() override;
+    int available() override;
+    int read() override;
+    int read(unsigned char *buffer, size_t length) override;
+    int read(char *buffer, size_t length) override { return read((unsigned char *)buffer, length); }
+    int peek() override;
+    void flush() override;
+
+    IPAddress remoteIP() override { return _remoteIP; }
+    uint16_t remotePort() override { return _remotePort; }
+
+private:
+    int _fd = -1;
+    IPAddress _txIP;
+    uint16_t _txPort = 0;
+    std::string _tx;
+    std::string _rx;
+    size_t _rxPos = 0;
+    IPAddress _remoteIP;
+    uint16_t _remotePort = 0;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef HOSTEMU_LWIP_DNS_H
+#define HOSTEMU_LWIP_DNS_H
+
+// lwIP's asynchronous resolver. Lookups run on a helper thread and the
+// callback is delivered from hostemu::serviceSystem(), like the sys-context
+// callback on the device.
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+
+#define ERR_OK 0
+#define ERR_INPROGRESS -5
+#define ERR_ARG -16
+
+typedef struct ip4_addr
+{
+    uint32_t addr;
+} ip4_addr_t;
+typedef ip4_addr_t ip_addr_t;
+
+#define ip_2_ip4(ipaddr) (ipaddr)
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr, void *callback_arg);
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg);
+
+#endif
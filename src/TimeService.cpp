@@ -0,0 +1,301 @@
+#include "TimeService.h"
+
+#define NTP_PORT 123
+#define NTP_LOCAL_PORT 2390
+#define NTP_PACKET_SIZE 48
+#define NTP_UNIX_OFFSET 2208988800LL  // Seconds from 1900 to 1970
+#define NTP_REPLY_TIMEOUT_US 2000000ULL
+#define NTP_RETRY_MIN_MS 2000         // First retry, doubling up to the poll interval
+#define NTP_MAX_FAILURES 4            // Resolve the server again after this many
+#define STEP_THRESHOLD_US 1000000LL   // Larger offsets are stepped instead of slewed
+#define MAX_SLEW_PPM 500              // Same limit as adjtime()
+#define MAX_DRIFT_PPM 500.0
+#define DRIFT_MIN_SPAN_US 16000000ULL // Shortest sample spacing used for drift
+#define DRIFT_MAX_ERROR_PPM 10        // Largest error a drift measurement may carry
+#define DRIFT_GAIN 0.25
+#define DELAY_SLACK_US 10000
+
+static int64_t ntpToEpochUs(const uint8_t *timestamp)
+{
+    uint32_t seconds = (uint32_t)timestamp[0] << 24 | (uint32_t)timestamp[1] << 16 | (uint32_t)timestamp[2] << 8 | timestamp[3];
+    uint32_t fraction = (uint32_t)timestamp[4] << 24 | (uint32_t)timestamp[5] << 16 | (uint32_t)timestamp[6] << 8 | timestamp[7];
+
+    // The seconds field wraps in February 2036; small values belong to the next era
+    int64_t unixSeconds = (int64_t)seconds - NTP_UNIX_OFFSET + ((seconds & 0x80000000) ? 0 : 0x100000000LL);
+    return unixSeconds * 1000000 + (int64_t)(((uint64_t)fraction * 1000000) >> 32);
+}
+
+TimeService::TimeService(const char *server, unsigned long pollIntervalMs)
+    : _server(server), _pollIntervalMs(pollIntervalMs)
+{
+}
+
+void TimeService::begin()
+{
+    _udp.begin(NTP_LOCAL_PORT);
+    _nextPollUs = 0;
+    resolveServer();
+}
+
+void TimeService::update()
+{
+    uint64_t now = nowUs();
+    switch (_state)
+    {
+    case STATE_RESOLVING:
+        if (_resolved)
+        {
+            _state = STATE_IDLE;
+        }
+        else if (_resolveFailed)
+        {
+            Serial.println("NTP server lookup failed");
+            _state = STATE_IDLE;
+            scheduleRetry();
+        }
+        break;
+
+    case STATE_WAITING:
+        if (receiveReply())
+        {
+            _state = STATE_IDLE;
+            _failures = 0;
+            _retryMs = 0;
+            _nextPollUs = now + _pollIntervalMs * 1000ULL;
+        }
+        else if (now - _sentUs > NTP_REPLY_TIMEOUT_US)
+        {
+            _state = STATE_IDLE;
+            scheduleRetry();
+        }
+        break;
+
+    case STATE_IDLE:
+        if (now >= _nextPollUs)
+        {
+            if (_resolved)
+            {
+                sendRequest();
+            }
+            else
+            {
+                resolveServer();
+            }
+        }
+        break;
+    }
+}
+
+int64_t TimeService::toEpochUs(uint64_t monoUs) const
+{
+    int64_t elapsed = (int64_t)(monoUs - _anchorUs);
+    int64_t epochUs = _anchorEpochUs + elapsed + (int64_t)(elapsed * (double)_driftPpm / 1000000.0);
+    if (elapsed > 0 && _slewUs != 0)
+    {
+        int64_t slewed = elapsed * MAX_SLEW_PPM / 1000000;
+        epochUs += _slewUs > 0 ? min(slewed, _slewUs) : max(-slewed, _slewUs);
+    }
+    return epochUs;
+}
+
+void TimeService::onServerFound(const char *name, const ip_addr_t *ipaddr, void *arg)
+{
+    (void)name;
+    TimeService *self = static_cast<TimeService *>(arg);
+    if (ipaddr)
+    {
+        self->_serverIP = IPAddress(ip_2_ip4(ipaddr)->addr);
+        self->_resolved = true;
+    }
+    else
+    {
+        self->_resolveFailed = true;
+    }
+}
+
+// Starts a lookup through lwIP's asynchronous resolver; WiFi.hostByName()
+// would block the loop until the answer arrives.
+void TimeService::resolveServer()
+{
+    ip_addr_t address;
+    _resolved = false;
+    _resolveFailed = false;
+    err_t err = dns_gethostbyname(_server, &address, onServerFound, this);
+    if (err == ERR_OK)
+    {
+        _serverIP = IPAddress(ip_2_ip4(&address)->addr);
+        _resolved = true;
+    }
+    else if (err == ERR_INPROGRESS)
+    {
+        _state = STATE_RESOLVING;
+    }
+    else
+    {
+        scheduleRetry();
+    }
+}
+
+void TimeService::sendRequest()
+{
+    uint8_t packet[NTP_PACKET_SIZE];
+    memset(packet, 0, sizeof(packet));
+    packet[0] = 0x23; // LI 0, version 4, mode 3 (client)
+
+    // A random transmit timestamp comes back as the reply's originate
+    // timestamp, which ties the reply to this request
+    for (size_t i = 0; i < sizeof(_cookie); i++)
+    {
+        _cookie[i] = random(256);
+    }
+    memcpy(packet + 40, _cookie, sizeof(_cookie));
+
+    // Drop late replies to earlier requests
+    while (_udp.parsePacket() > 0)
+    {
+        _udp.flush();
+    }
+
+    if (!_udp.beginPacket(_serverIP, NTP_PORT))
+    {
+        scheduleRetry();
+        return;
+    }
+    _udp.write(packet, sizeof(packet));
+    _sentUs = nowUs();
+    if (!_udp.endPacket())
+    {
+        scheduleRetry();
+        return;
+    }
+    _state = STATE_WAITING;
+}
+
+bool TimeService::receiveReply()
+{
+    int size = _udp.parsePacket();
+    if (size <= 0)
+    {
+        return false;
+    }
+    uint64_t receivedUs = nowUs();
+
+    uint8_t packet[NTP_PACKET_SIZE];
+    if (size < NTP_PACKET_SIZE || _udp.remoteIP() != _serverIP)
+    {
+        _udp.flush();
+        return false;
+    }
+    _udp.read(packet, sizeof(packet));
+    _udp.flush();
+
+    uint8_t leap = packet[0] >> 6;
+    uint8_t mode = packet[0] & 0x07;
+    uint8_t stratum = packet[1];
+    if (mode != 4 || memcmp(packet + 24, _cookie, sizeof(_cookie)) != 0)
+    {
+        return false;
+    }
+    if (leap == 3 || stratum == 0 || stratum > 15)
+    {
+        // Unsynchronised server or kiss-o'-death; let the request time out
+        return false;
+    }
+
+    int64_t serverReceiveUs = ntpToEpochUs(packet + 32);
+    int64_t serverTransmitUs = ntpToEpochUs(packet + 40);
+    uint64_t roundTripUs = receivedUs - _sentUs;
+    int64_t serverHoldUs = serverTransmitUs - serverReceiveUs;
+    uint64_t delayUs = (serverHoldUs >= 0 && (uint64_t)serverHoldUs < roundTripUs) ? roundTripUs - serverHoldUs : 0;
+
+    // Assume a symmetric path: the server's midpoint matches ours
+    discipline(nowUs(), _sentUs + roundTripUs / 2, serverReceiveUs + serverHoldUs / 2, delayUs);
+    return true;
+}
+
+void TimeService::scheduleRetry()
+{
+    if (++_failures >= NTP_MAX_FAILURES)
+    {
+        // Pool servers come and go; look the name up again next time
+        _failures = 0;
+        _resolved = false;
+    }
+    _retryMs = _retryMs ? min(_retryMs * 2, _pollIntervalMs) : NTP_RETRY_MIN_MS;
+    _nextPollUs = nowUs() + _retryMs * 1000ULL;
+}
+
+void TimeService::discipline(uint64_t now, uint64_t monoUs, int64_t epochUs, uint64_t delayUs)
+{
+    // A reply that sat in a queue somewhere carries a stale timestamp. The
+    // reference delay creeps up on each rejection in case the path got slower.
+    if (_valid && delayUs > 2 * _bestDelayUs + DELAY_SLACK_US)
+    {
+        _bestDelayUs += _bestDelayUs / 4 + 1000;
+        return;
+    }
+    if (!_valid || delayUs < _bestDelayUs)
+    {
+        _bestDelayUs = delayUs;
+    }
+
+    _lastSyncUs = now;
+
+    if (!_valid)
+    {
+        _anchorUs = monoUs;
+        _anchorEpochUs = epochUs;
+        _sampleUs = monoUs;
+        _sampleEpochUs = epochUs;
+        _sampleDelayUs = delayUs;
+        _valid = true;
+        Serial.println("Time synchronised");
+        return;
+    }
+
+    // Offset and the current wall time according to the old model
+    int64_t offsetUs = epochUs - toEpochUs(monoUs);
+    int64_t currentUs = toEpochUs(now);
+
+    // Frequency error of the CPU clock against the server. Each sample's
+    // offset is only known to within half its round trip, so the baseline
+    // grows until that error is small next to the span it is spread over.
+    uint64_t span = monoUs - _sampleUs;
+    uint64_t errorUs = (_sampleDelayUs + delayUs) / 2;
+    if (span >= DRIFT_MIN_SPAN_US && errorUs * 1000000 <= span * DRIFT_MAX_ERROR_PPM)
+    {
+        double measuredPpm = ((double)(epochUs - _sampleEpochUs) - (double)span) / (double)span * 1000000.0;
+        if (fabs(measuredPpm) <= MAX_DRIFT_PPM)
+        {
+            _driftPpm += (measuredPpm - _driftPpm) * DRIFT_GAIN;
+        }
+        _sampleUs = monoUs;
+        _sampleEpochUs = epochUs;
+        _sampleDelayUs = delayUs;
+    }
+    else if (delayUs < _sampleDelayUs && span * DRIFT_MAX_ERROR_PPM < (_sampleDelayUs - delayUs) / 2 * 1000000)
+    {
+        // A slow baseline, such as a first reply that nearly timed out, would
+        // hold off the estimate for hours; restart from this reply when that
+        // makes the span usable sooner than waiting on
+        _sampleUs = monoUs;
+        _sampleEpochUs = epochUs;
+        _sampleDelayUs = delayUs;
+    }
+
+    // Re-anchor at the current reading so the wall clock stays continuous
+    _anchorUs = now;
+    if (offsetUs > STEP_THRESHOLD_US || offsetUs < -STEP_THRESHOLD_US)
+    {
+        _anchorEpochUs = currentUs + offsetUs;
+        _slewUs = 0;
+        Serial.print("Time stepped by ");
+        Serial.print((long)(offsetUs / 1000));
+        Serial.println(" ms");
+    }
+    else
+    {
+        _anchorEpochUs = currentUs;
+        _slewUs = offsetUs;
+    }
+}
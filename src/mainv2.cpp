@@ -5,10 +5,9 @@
 #include <LittleFS.h>
 #include <ArduinoJson.h>
 #include <PubSubClient.h>
-#include <NTPClient.h>
-#include <WiFiUdp.h>
 #include <EEPROM.h>
 #include "config.h"
+#include "TimeService.h"
 
 #define FLOW_SENSOR_PIN D2
 #define NO_FLOW_TIMEOUT 2000 // Timeout to determine no flow in milliseconds
@@ -19,11 +18,10 @@ float kFactor = 0.0;           // Default value, will be loaded from config
 AsyncWebServer server(80);
 WiFiClient espClient;
 PubSubClient client(espClient);
-WiFiUDP ntpUDP;
-NTPClient timeClient(ntpUDP, "pool.ntp.org", 0, 60000); // Update every 60 seconds
+TimeService timeService("pool.ntp.org", 60000); // Poll every 60 seconds
 
 volatile int pulseCount = 0;
-unsigned long lastPulseTime = 0;
+volatile uint64_t lastPulseTime = 0; // TimeService::nowUs() of the last pulse
 bool flowDetected = false;
 
 struct FilterData
@@ -49,7 +47,7 @@ struct TotalData
 
 TotalData totalData = {0.0, "", 0};
 
-unsigned long oldTime = 0;
+uint64_t oldTime = 0;
 unsigned long lastPublishTime = 0;
 String macAddr;
 
@@ -59,6 +57,31 @@ String macAddr;
 #define CERAMIC_FILTER_ADDRESS (KDF_GAC_FILTER_ADDRESS + sizeof(FilterData))
 #define TOTAL_LITRES_ADDRESS (CERAMIC_FILTER_ADDRESS + sizeof(FilterData))
 
+// Time of a reset. Resets made before the clock is valid are pending: only
+// the monotonic time is known and the stored date is filled in once time has
+// been synchronised. Until then days are counted from monoUs.
+struct ResetTime
+{
+    char text[20];
+    time_t epoch;
+    uint64_t monoUs;
+    bool pending;
+};
+
+struct PendingTimestamp
+{
+    char *text;
+    size_t textSize;
+    unsigned long *timestamp;
+    uint64_t monoUs;
+};
+
+#define MAX_PENDING_TIMESTAMPS 4 // Three filters and the full reset
+#define MIN_VALID_EPOCH 1577836800UL // 2020-01-01; older stamps were taken before time was valid
+#define PENDING_TIMESTAMP 1 // Saved for a reset whose date is not known yet; 0 means never set
+PendingTimestamp pendingTimestamps[MAX_PENDING_TIMESTAMPS];
+int pendingTimestampCount = 0;
+
 void setup_wifi();
 void callback(char *topic, byte *payload, unsigned int length);
 bool reconnect();
@@ -68,8 +91,13 @@ void initializeEEPROM();
 void publishUsage();
 void publishFilterData(const char *filterName, FilterData &filterData, float maxLitres, unsigned long maxDays);
 void publishAllTimeData();
-void updateTimestamp(char *buffer, size_t bufferSize);
-void initializeFilterData(FilterData &data);
+void formatTimestamp(time_t time, char *buffer, size_t bufferSize);
+ResetTime currentResetTime();
+ResetTime parseResetTime(const char *date);
+void applyResetTime(char *text, size_t textSize, unsigned long &timestamp, const ResetTime &resetTime);
+void resolvePendingTimestamps();
+bool findPendingTimestamp(const unsigned long &timestamp, uint64_t &monoUs);
+void queueUndatedTimestamp(char *text, size_t textSize, unsigned long &timestamp);
 void eraseEEPROM();
 bool publishWithRetry(const char *topic, const char *payload, int retryCount = 3);
 void calculateRemainingLifespan(FilterData &data, float maxLitres, unsigned long maxDays);
@@ -81,16 +109,122 @@ void calculateFlow();
 IRAM_ATTR void pulseCounter()
 {
     pulseCount++;
-    lastPulseTime = millis();
+    lastPulseTime = TimeService::nowUs();
 }
 
-void updateTimestamp(char *buffer, size_t bufferSize)
+void formatTimestamp(time_t time, char *buffer, size_t bufferSize)
 {
-    time_t now = timeClient.getEpochTime();
-    struct tm *tm = localtime(&now);
+    struct tm *tm = localtime(&time);
     strftime(buffer, bufferSize, "%Y-%m-%d %H:%M:%S", tm);
 }
 
+ResetTime currentResetTime()
+{
+    ResetTime resetTime;
+    resetTime.monoUs = TimeService::nowUs();
+    resetTime.pending = !timeService.isValid();
+    resetTime.epoch = resetTime.pending ? PENDING_TIMESTAMP : timeService.toEpoch(resetTime.monoUs);
+    resetTime.text[0] = '\0';
+    if (!resetTime.pending)
+    {
+        formatTimestamp(resetTime.epoch, resetTime.text, sizeof(resetTime.text));
+    }
+    return resetTime;
+}
+
+ResetTime parseResetTime(const char *date)
+{
+    struct tm tm;
+    memset(&tm, 0, sizeof(struct tm)); // Initialize to zero
+    if (!date || !strptime(date, "%Y-%m-%d %H:%M:%S", &tm))
+    {
+        if (date)
+        {
+            Serial.println("Failed to parse date, using current time");
+        }
+        return currentResetTime();
+    }
+
+    ResetTime resetTime;
+    resetTime.epoch = mktime(&tm);
+    resetTime.monoUs = 0;
+    resetTime.pending = false;
+    strftime(resetTime.text, sizeof(resetTime.text), "%Y-%m-%d %H:%M:%S", &tm);
+    Serial.print("Parsed date: ");
+    Serial.println(resetTime.text);
+    return resetTime;
+}
+
+void applyResetTime(char *text, size_t textSize, unsigned long &timestamp, const ResetTime &resetTime)
+{
+    strncpy(text, resetTime.text, textSize);
+    timestamp = resetTime.epoch;
+
+    // A newer reset replaces any stamp still waiting for this field
+    for (int i = 0; i < pendingTimestampCount; i++)
+    {
+        if (pendingTimestamps[i].timestamp == &timestamp)
+        {
+            pendingTimestamps[i] = pendingTimestamps[--pendingTimestampCount];
+            break;
+        }
+    }
+    if (resetTime.pending && pendingTimestampCount < MAX_PENDING_TIMESTAMPS)
+    {
+        pendingTimestamps[pendingTimestampCount++] = {text, textSize, &timestamp, resetTime.monoUs};
+    }
+}
+
+void resolvePendingTimestamps()
+{
+    if (pendingTimestampCount == 0 || !timeService.isValid())
+    {
+        return;
+    }
+
+    for (int i = 0; i < pendingTimestampCount; i++)
+    {
+        PendingTimestamp &pending = pendingTimestamps[i];
+        time_t epoch = timeService.toEpoch(pending.monoUs);
+        formatTimestamp(epoch, pending.text, pending.textSize);
+        *pending.timestamp = epoch;
+    }
+    pendingTimestampCount = 0;
+
+    saveFilterData(CARBON_FILTER_ADDRESS, carbonFilter);
+    saveFilterData(KDF_GAC_FILTER_ADDRESS, kdfGacFilter);
+    saveFilterData(CERAMIC_FILTER_ADDRESS, ceramicFilter);
+    saveTotalData(TOTAL_LITRES_ADDRESS, totalData);
+    Serial.println("Reset timestamps set from synchronised time.");
+}
+
+bool findPendingTimestamp(const unsigned long &timestamp, uint64_t &monoUs)
+{
+    for (int i = 0; i < pendingTimestampCount; i++)
+    {
+        if (pendingTimestamps[i].timestamp == &timestamp)
+        {
+            monoUs = pendingTimestamps[i].monoUs;
+            return true;
+        }
+    }
+    return false;
+}
+
+// A filter reset saved before the clock was valid has PENDING_TIMESTAMP, or
+// seconds since boot from older firmware, instead of a date. It happened
+// before this boot, so the boot time is the closest known time for it. 0
+// was never set and stays unknown.
+void queueUndatedTimestamp(char *text, size_t textSize, unsigned long &timestamp)
+{
+    if (timestamp == 0 || timestamp >= MIN_VALID_EPOCH)
+    {
+        return;
+    }
+    ResetTime resetTime = {"", PENDING_TIMESTAMP, 0, true};
+    applyResetTime(text, textSize, timestamp, resetTime);
+}
+
 String formatValue(float value) {
     if (value >= 1000000) {
         return String(value / 1000000, 2) + "M";
@@ -120,13 +254,16 @@ void setup()
     client.setServer(mqtt_server, 1883);
     client.setCallback(callback);
 
-    timeClient.begin();
+    timeService.begin();
 
     initializeEEPROM();
     loadFilterData(CARBON_FILTER_ADDRESS, carbonFilter);
     loadFilterData(KDF_GAC_FILTER_ADDRESS, kdfGacFilter);
     loadFilterData(CERAMIC_FILTER_ADDRESS, ceramicFilter);
     loadTotalData(TOTAL_LITRES_ADDRESS, totalData);
+    queueUndatedTimestamp(carbonFilter.lastChanged, sizeof(carbonFilter.lastChanged), carbonFilter.lastChangedTimestamp);
+    queueUndatedTimestamp(kdfGacFilter.lastChanged, sizeof(kdfGacFilter.lastChanged), kdfGacFilter.lastChangedTimestamp);
+    queueUndatedTimestamp(ceramicFilter.lastChanged, sizeof(ceramicFilter.lastChanged), ceramicFilter.lastChangedTimestamp);
 
     // Load sensor configuration from file
     if (!loadConfig("/config.json", "YF-G1"))
@@ -159,6 +296,7 @@ void setup()
         doc["ceramicChanged"] = ceramicFilter.lastChanged;
         doc["ceramicRemaining"] = formatValue(ceramicFilter.remainingLitres);
         doc["ceramicRemainingDays"] = ceramicFilter.remainingDays;
+        doc["timeValid"] = timeService.isValid();
         String jsonResponse;
         serializeJson(doc, jsonResponse);
         request->send(200, "application/json", jsonResponse); });
@@ -177,67 +315,46 @@ void setup()
             dateStr = request->getParam("date", true)->value();
         }
 
-        char dateBuffer[20];
-        time_t resetTime;
-        struct tm tm;
-        memset(&tm, 0, sizeof(struct tm)); // Initialize to zero
-
-        if (strptime(dateStr.c_str(), "%Y-%m-%d %H:%M:%S", &tm)) {
-            resetTime = mktime(&tm);
-            strftime(dateBuffer, sizeof(dateBuffer), "%Y-%m-%d %H:%M:%S", &tm);
-            Serial.print("Parsed date: ");
-            Serial.println(dateBuffer);
-        } else {
-            Serial.println("Failed to parse date, using current time");
-            updateTimestamp(dateBuffer, sizeof(dateBuffer));
-            resetTime = timeClient.getEpochTime();
-        }
+        ResetTime resetTime = parseResetTime(dateStr.c_str());
 
         if (filterType == "carbon") {
             carbonFilter.initialLitres = totalData.allTimeLitres;
             carbonFilter.processedLitres = 0.0;
-            strncpy(carbonFilter.lastChanged, dateBuffer, sizeof(carbonFilter.lastChanged));
-            carbonFilter.lastChangedTimestamp = resetTime;
+            applyResetTime(carbonFilter.lastChanged, sizeof(carbonFilter.lastChanged), carbonFilter.lastChangedTimestamp, resetTime);
             saveFilterData(CARBON_FILTER_ADDRESS, carbonFilter);
             Serial.println("Carbon filter reset.");
         } else if (filterType == "kdfgac") {
             kdfGacFilter.initialLitres = totalData.allTimeLitres;
             kdfGacFilter.processedLitres = 0.0;
-            strncpy(kdfGacFilter.lastChanged, dateBuffer, sizeof(kdfGacFilter.lastChanged));
-            kdfGacFilter.lastChangedTimestamp = resetTime;
+            applyResetTime(kdfGacFilter.lastChanged, sizeof(kdfGacFilter.lastChanged), kdfGacFilter.lastChangedTimestamp, resetTime);
             saveFilterData(KDF_GAC_FILTER_ADDRESS, kdfGacFilter);
             Serial.println("KDF/GAC filter reset.");
         } else if (filterType == "ceramic") {
             ceramicFilter.initialLitres = totalData.allTimeLitres;
             ceramicFilter.processedLitres = 0.0;
-            strncpy(ceramicFilter.lastChanged, dateBuffer, sizeof(ceramicFilter.lastChanged));
-            ceramicFilter.lastChangedTimestamp = resetTime;
+            applyResetTime(ceramicFilter.lastChanged, sizeof(ceramicFilter.lastChanged), ceramicFilter.lastChangedTimestamp, resetTime);
             saveFilterData(CERAMIC_FILTER_ADDRESS, ceramicFilter);
             Serial.println("Ceramic filter reset.");
         } else if (filterType == "full") {
             // Reset total data
             totalData.allTimeLitres = 0.0;
-            strncpy(totalData.lastReset, dateBuffer, sizeof(totalData.lastReset));
-            totalData.lastFullResetTimestamp = resetTime;
+            applyResetTime(totalData.lastReset, sizeof(totalData.lastReset), totalData.lastFullResetTimestamp, resetTime);
             saveTotalData(TOTAL_LITRES_ADDRESS, totalData);
 
             // Reset filter data
             carbonFilter.initialLitres = 0.0;
             carbonFilter.processedLitres = 0.0;
-            strncpy(carbonFilter.lastChanged, dateBuffer, sizeof(carbonFilter.lastChanged));
-            carbonFilter.lastChangedTimestamp = resetTime;
+            applyResetTime(carbonFilter.lastChanged, sizeof(carbonFilter.lastChanged), carbonFilter.lastChangedTimestamp, resetTime);
             saveFilterData(CARBON_FILTER_ADDRESS, carbonFilter);
 
             kdfGacFilter.initialLitres = 0.0;
             kdfGacFilter.processedLitres = 0.0;
-            strncpy(kdfGacFilter.lastChanged, dateBuffer, sizeof(kdfGacFilter.lastChanged));
-            kdfGacFilter.lastChangedTimestamp = resetTime;
+            applyResetTime(kdfGacFilter.lastChanged, sizeof(kdfGacFilter.lastChanged), kdfGacFilter.lastChangedTimestamp, resetTime);
             saveFilterData(KDF_GAC_FILTER_ADDRESS, kdfGacFilter);
 
             ceramicFilter.initialLitres = 0.0;
             ceramicFilter.processedLitres = 0.0;
-            strncpy(ceramicFilter.lastChanged, dateBuffer, sizeof(ceramicFilter.lastChanged));
-            ceramicFilter.lastChangedTimestamp = resetTime;
+            applyResetTime(ceramicFilter.lastChanged, sizeof(ceramicFilter.lastChanged), ceramicFilter.lastChangedTimestamp, resetTime);
             saveFilterData(CERAMIC_FILTER_ADDRESS, ceramicFilter);
 
             Serial.println("Full reset performed.");
@@ -247,7 +364,7 @@ void setup()
         request->send(200, "text/html", "<html><body><h1>Reset Completed</h1><a href=\"/\">Back to Home</a></body></html>"); });
 
     server.begin();
-    oldTime = millis(); // Initialize oldTime at the beginning
+    oldTime = TimeService::nowUs(); // Initialize oldTime at the beginning
 }
 
 void loop()
@@ -257,12 +374,13 @@ void loop()
         reconnect();
     }
     client.loop();
-    timeClient.update();
+    timeService.update();
+    resolvePendingTimestamps();
 
-    unsigned long currentTime = millis();
-    unsigned long elapsedTime = currentTime - oldTime;
+    uint64_t currentTime = TimeService::nowUs();
+    uint64_t elapsedTime = currentTime - oldTime;
 
-    if (elapsedTime >= 1000)
+    if (elapsedTime >= 1000000)
     { // Update every second (or when enough time has passed)
         detachInterrupt(digitalPinToInterrupt(FLOW_SENSOR_PIN));
 
@@ -289,18 +407,18 @@ void calculateFlow()
         Serial.println("Warning: NaN detected in litresThisPeriod. Total volume not updated.");
     }
 
-    unsigned long currentTime = millis();
-    unsigned long elapsedTime = currentTime - oldTime;
+    uint64_t currentTime = TimeService::nowUs();
+    uint64_t elapsedTime = currentTime - oldTime;
     oldTime = currentTime; // Update oldTime for the next calculation
 
     // Calculate pulse frequency
-    float pulseFrequency = (float)pulseCount / (elapsedTime / 1000.0);
+    float pulseFrequency = (float)pulseCount / (elapsedTime / 1000000.0);
 
     // Calculate flow rate (combine both methods)
     float flowRate = pulseFrequency / kFactor; // Frequency-based calculation
 
     // Check for no flow detection
-    if (currentTime - lastPulseTime > NO_FLOW_TIMEOUT)
+    if (currentTime - lastPulseTime > NO_FLOW_TIMEOUT * 1000ULL)
     {
         flowDetected = false;
     }
@@ -456,13 +574,6 @@ void publishAllTimeData()
     }
 }
 
-void initializeFilterData(FilterData &data)
-{
-    data.initialLitres = 0.0;
-    updateTimestamp(data.lastChanged, sizeof(data.lastChanged));
-    data.lastChangedTimestamp = timeClient.getEpochTime();
-}
-
 void eraseEEPROM()
 {
     for (size_t i = 0; i < EEPROM.length(); i++)
@@ -531,55 +642,30 @@ void callback(char *topic, byte *payload, unsigned int length)
     const char *command = doc["command"];
     const char *filter = doc["filter"];
     const char *date = doc["date"];
-    char dateBuffer[20];
-    time_t resetTime;
-
-    if (date)
-    {
-        strncpy(dateBuffer, date, sizeof(dateBuffer));
-        struct tm tm;
-        if (strptime(date, "%Y-%m-%d %H:%M:%S", &tm))
-        {
-            resetTime = mktime(&tm);
-        }
-        else
-        {
-            Serial.println("Failed to parse date, using current time");
-            resetTime = timeClient.getEpochTime();
-        }
-    }
-    else
-    {
-        updateTimestamp(dateBuffer, sizeof(dateBuffer));
-        resetTime = timeClient.getEpochTime();
-    }
+    ResetTime resetTime = parseResetTime(date);
 
     if (command && strcmp(command, "full_reset") == 0)
     {
         // Perform a full reset
         totalData.allTimeLitres = 0.0;
-        totalData.lastFullResetTimestamp = resetTime;
-        strncpy(totalData.lastReset, dateBuffer, sizeof(totalData.lastReset));
+        applyResetTime(totalData.lastReset, sizeof(totalData.lastReset), totalData.lastFullResetTimestamp, resetTime);
         Serial.println("Performing full reset.");
         saveTotalData(TOTAL_LITRES_ADDRESS, totalData);
 
         // Reset filter data
         carbonFilter.initialLitres = 0.0;
         carbonFilter.processedLitres = 0.0;
-        strncpy(carbonFilter.lastChanged, dateBuffer, sizeof(carbonFilter.lastChanged));
-        carbonFilter.lastChangedTimestamp = resetTime;
+        applyResetTime(carbonFilter.lastChanged, sizeof(carbonFilter.lastChanged), carbonFilter.lastChangedTimestamp, resetTime);
         saveFilterData(CARBON_FILTER_ADDRESS, carbonFilter);
 
         kdfGacFilter.initialLitres = 0.0;
         kdfGacFilter.processedLitres = 0.0;
-        strncpy(kdfGacFilter.lastChanged, dateBuffer, sizeof(kdfGacFilter.lastChanged));
-        kdfGacFilter.lastChangedTimestamp = resetTime;
+        applyResetTime(kdfGacFilter.lastChanged, sizeof(kdfGacFilter.lastChanged), kdfGacFilter.lastChangedTimestamp, resetTime);
         saveFilterData(KDF_GAC_FILTER_ADDRESS, kdfGacFilter);
 
         ceramicFilter.initialLitres = 0.0;
         ceramicFilter.processedLitres = 0.0;
-        strncpy(ceramicFilter.lastChanged, dateBuffer, sizeof(ceramicFilter.lastChanged));
-        ceramicFilter.lastChangedTimestamp = resetTime;
+        applyResetTime(ceramicFilter.lastChanged, sizeof(ceramicFilter.lastChanged), ceramicFilter.lastChangedTimestamp, resetTime);
         saveFilterData(CERAMIC_FILTER_ADDRESS, ceramicFilter);
     }
     else if (filter)
@@ -588,8 +674,7 @@ void callback(char *topic, byte *payload, unsigned int length)
         {
             carbonFilter.initialLitres = totalData.allTimeLitres;
             carbonFilter.processedLitres = 0.0;
-            strncpy(carbonFilter.lastChanged, dateBuffer, sizeof(carbonFilter.lastChanged));
-            carbonFilter.lastChangedTimestamp = resetTime;
+            applyResetTime(carbonFilter.lastChanged, sizeof(carbonFilter.lastChanged), carbonFilter.lastChangedTimestamp, resetTime);
             saveFilterData(CARBON_FILTER_ADDRESS, carbonFilter);
             Serial.println("Carbon filter reset.");
         }
@@ -597,8 +682,7 @@ void callback(char *topic, byte *payload, unsigned int length)
         {
             kdfGacFilter.initialLitres = totalData.allTimeLitres;
             kdfGacFilter.processedLitres = 0.0;
-            strncpy(kdfGacFilter.lastChanged, dateBuffer, sizeof(kdfGacFilter.lastChanged));
-            kdfGacFilter.lastChangedTimestamp = resetTime;
+            applyResetTime(kdfGacFilter.lastChanged, sizeof(kdfGacFilter.lastChanged), kdfGacFilter.lastChangedTimestamp, resetTime);
             saveFilterData(KDF_GAC_FILTER_ADDRESS, kdfGacFilter);
             Serial.println("KDF/GAC filter reset.");
         }
@@ -606,8 +690,7 @@ void callback(char *topic, byte *payload, unsigned int length)
         {
             ceramicFilter.initialLitres = totalData.allTimeLitres;
             ceramicFilter.processedLitres = 0.0;
-            strncpy(ceramicFilter.lastChanged, dateBuffer, sizeof(ceramicFilter.lastChanged));
-            ceramicFilter.lastChangedTimestamp = resetTime;
+            applyResetTime(ceramicFilter.lastChanged, sizeof(ceramicFilter.lastChanged), ceramicFilter.lastChangedTimestamp, resetTime);
             saveFilterData(CERAMIC_FILTER_ADDRESS, ceramicFilter);
             Serial.println("Ceramic filter reset.");
         }
@@ -655,9 +738,23 @@ bool loadConfig(const char *filename, const char *sensorName)
 }
 
 void calculateRemainingLifespan(FilterData &data, float maxLitres, unsigned long maxDays) {
-    // Calculate the days since the filter was last changed
-    unsigned long currentTime = timeClient.getEpochTime();
-    unsigned long daysSinceChanged = (currentTime - data.lastChangedTimestamp) / 86400;
+    // Count days from the change date or, for a reset still waiting for the
+    // clock, from the monotonic time of the reset. Without either the
+    // previous remaining days are kept.
+    bool daysKnown = true;
+    unsigned long currentTime = 0;
+    unsigned long daysSinceChanged = 0;
+    uint64_t changedUs;
+    if (findPendingTimestamp(data.lastChangedTimestamp, changedUs)) {
+        daysSinceChanged = (TimeService::nowUs() - changedUs) / 86400000000ULL;
+    } else if (timeService.isValid() && data.lastChangedTimestamp >= MIN_VALID_EPOCH) {
+        currentTime = timeService.epoch();
+        if (currentTime > data.lastChangedTimestamp) {
+            daysSinceChanged = (currentTime - data.lastChangedTimestamp) / 86400;
+        }
+    } else {
+        daysKnown = false;
+    }
 
     // Infer processed litres if no litres have been recorded yet and days have passed
     if (data.processedLitres == 0 && daysSinceChanged > 0) {
@@ -674,7 +771,9 @@ void calculateRemainingLifespan(FilterData &data, float maxLitres, unsigned long
         data.remainingLitres = 0; // Ensure remaining litres do not go negative
     }
 
-    data.remainingDays = (maxDays > daysSinceChanged) ? (maxDays - daysSinceChanged) : 0;
+    if (daysKnown) {
+        data.remainingDays = (maxDays > daysSinceChanged) ? (maxDays - daysSinceChanged) : 0;
+    }
 
     // Debug statements
   /*  Serial.print("Current time: "); Serial.println(currentTime);
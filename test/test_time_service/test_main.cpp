@@ -0,0 +1,157 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "TimeService.h"
+
+// Drives TimeService::discipline() with simulated NTP replies. The CPU clock
+// is the simulated monotonic time; the server's clock runs driftPpm faster
+// than it and starts at SERVER_EPOCH_US.
+#define SERVER_EPOCH_US 1700000000000000LL
+#define POLL_US 16000000ULL
+#define HOUR_US 3600000000ULL
+
+struct Simulation
+{
+    TimeService service{"127.0.0.1"};
+    uint64_t monoUs = 1000000;
+    double driftPpm = 0.0;
+    int64_t offsetUs = 0;
+    uint32_t seed = 1;
+
+    int64_t serverUs(uint64_t mono) const
+    {
+        return SERVER_EPOCH_US + offsetUs + (int64_t)mono + (int64_t)(mono * driftPpm / 1000000.0);
+    }
+
+    uint32_t jitterUs(uint32_t maxUs)
+    {
+        seed = seed * 1664525 + 1013904223;
+        return maxUs ? (seed >> 8) % (maxUs + 1) : 0;
+    }
+
+    // One request/reply. The request arrives after a fixed 1 ms and the
+    // reply is held up by up to extraUs more than baseUs, so its offset is
+    // biased by up to half of that.
+    void exchange(uint32_t extraUs, uint32_t baseUs = 2000)
+    {
+        uint64_t sent = monoUs;
+        uint64_t delay = baseUs + jitterUs(extraUs);
+        int64_t serverTime = serverUs(sent + 1000);
+        monoUs = sent + delay;
+        service.discipline(monoUs, sent + delay / 2, serverTime, delay);
+    }
+};
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_invalid_until_first_reply()
+{
+    Simulation sim;
+    TEST_ASSERT_FALSE(sim.service.isValid());
+
+    sim.exchange(0);
+    TEST_ASSERT_TRUE(sim.service.isValid());
+    TEST_ASSERT_INT64_WITHIN(1000, sim.serverUs(sim.monoUs), sim.service.toEpochUs(sim.monoUs));
+}
+
+void test_small_offset_is_slewed()
+{
+    Simulation sim;
+    sim.exchange(0);
+
+    sim.monoUs += POLL_US;
+    sim.offsetUs = 200000;
+    int64_t before = sim.service.toEpochUs(sim.monoUs);
+    sim.exchange(0);
+
+    // No jump at the sample, then 500 ppm of slew until the offset is gone
+    TEST_ASSERT_INT64_WITHIN(5000, before, sim.service.toEpochUs(sim.monoUs));
+    TEST_ASSERT_INT64_WITHIN(1000, sim.serverUs(sim.monoUs + 200000000ULL) - 100000, sim.service.toEpochUs(sim.monoUs + 200000000ULL));
+    TEST_ASSERT_INT64_WITHIN(1000, sim.serverUs(sim.monoUs + 500000000ULL), sim.service.toEpochUs(sim.monoUs + 500000000ULL));
+}
+
+void test_large_offset_is_stepped()
+{
+    Simulation sim;
+    sim.exchange(0);
+
+    sim.monoUs += POLL_US;
+    sim.offsetUs = 5000000;
+    sim.exchange(0);
+    TEST_ASSERT_INT64_WITHIN(1000, sim.serverUs(sim.monoUs), sim.service.toEpochUs(sim.monoUs));
+}
+
+// Delay jitter must not show up as drift: with a perfect clock and up to
+// 10 ms of extra delay the estimate stays well inside crystal tolerance,
+// and wall time never runs backwards.
+void test_jitter_does_not_create_drift()
+{
+    Simulation sim;
+    sim.exchange(10000);
+
+    int64_t last = sim.service.toEpochUs(sim.monoUs);
+    float worst = 0.0;
+    while (sim.monoUs < 12 * HOUR_US)
+    {
+        sim.monoUs += POLL_US;
+        TEST_ASSERT_TRUE(sim.service.toEpochUs(sim.monoUs) >= last);
+        sim.exchange(10000);
+        int64_t now = sim.service.toEpochUs(sim.monoUs);
+        TEST_ASSERT_TRUE(now >= last);
+        last = now;
+        worst = max(worst, (float)fabs(sim.service.driftPpm()));
+    }
+    TEST_ASSERT_FLOAT_WITHIN(5.0, 0.0, worst);
+}
+
+void test_drift_is_estimated()
+{
+    Simulation sim;
+    sim.driftPpm = 20.0;
+    sim.exchange(10000);
+    while (sim.monoUs < 12 * HOUR_US)
+    {
+        sim.monoUs += POLL_US;
+        sim.exchange(10000);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(2.0, 20.0, sim.service.driftPpm());
+
+    // A free-running hour keeps to within a few ms of the server
+    uint64_t later = sim.monoUs + HOUR_US;
+    TEST_ASSERT_INT64_WITHIN(10000, sim.serverUs(later), sim.service.toEpochUs(later));
+}
+
+// A first reply that nearly timed out must not hold off drift estimation
+// until a span long enough to cover its delay has passed
+void test_slow_first_reply()
+{
+    Simulation sim;
+    sim.driftPpm = 20.0;
+    sim.exchange(0, 1900000);
+    while (sim.monoUs < 4 * HOUR_US)
+    {
+        sim.monoUs += POLL_US;
+        sim.exchange(10000);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(2.0, 20.0, sim.service.driftPpm());
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_invalid_until_first_reply);
+    RUN_TEST(test_small_offset_is_slewed);
+    RUN_TEST(test_large_offset_is_stepped);
+    RUN_TEST(test_jitter_does_not_create_drift);
+    RUN_TEST(test_drift_is_estimated);
+    RUN_TEST(test_slow_first_reply);
+    return UNITY_END();
+}
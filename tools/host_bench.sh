@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+# Builds the host emulation (env:native) and runs the load benchmark against
+# a local mosquitto broker, starting a throwaway one on port 1883 if nothing
+# is listening there yet. Extra arguments are passed to the emulator, e.g.
+#   tools/host_bench.sh --bench 60 --pulse-hz 250 --pollers 8
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+pio run -e native
+
+broker_pid=""
+if ! (exec 3<>/dev/tcp/127.0.0.1/1883) 2>/dev/null; then
+    mosquitto -p 1883 >/dev/null 2>&1 &
+    broker_pid=$!
+    trap 'kill "$broker_pid" 2>/dev/null || true' EXIT
+    sleep 0.5
+fi
+
+.pio/build/native/program --quiet --fs data --bench 30 "$@"